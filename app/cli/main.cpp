@@ -0,0 +1,147 @@
+#include "trainconfig.h"
+#include "trainer.h"
+#include "ClossNet.h"
+#include "Profiler.h"
+#include <OpenANN/OpenANN>
+#include <OpenANN/optimization/StoppingInterrupt.h>
+#include <OpenANN/util/Random.h>
+#include <Eigen/Core>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <memory>
+
+using OpenANN::Net;
+using namespace Trainer;
+
+namespace {
+
+void usage(const char *program)
+{
+    std::cerr << "Usage: " << program << " <config> [key=value]...\n"
+              << "Trains a network without GUI. Entries given on the command "
+              << "line override the config file, e.g. randSeed=3.\n";
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+    if (argc < 2) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    // Step 1. read configuration
+    TrainConfig config;
+    std::string error;
+    std::ifstream configFile(argv[1]);
+    if (!configFile) {
+        std::cerr << "Cannot open config file " << argv[1] << std::endl;
+        return 1;
+    }
+    if (!config.read(configFile, error)) {
+        std::cerr << argv[1] << ": " << error << std::endl;
+        return 1;
+    }
+    for (int i = 2; i < argc; i++) {
+        std::string entry(argv[i]);
+        const size_t eq = entry.find('=');
+        if (eq != std::string::npos)
+            entry[eq] = ' ';
+        if (!config.set(entry, error)) {
+            std::cerr << argv[i] << ": " << error << std::endl;
+            return 1;
+        }
+    }
+    if (!config.validate(error)) {
+        std::cerr << argv[1] << ": " << error << std::endl;
+        return 1;
+    }
+
+    // Step 2. setup data source
+    Data data;
+    if (!loadData(config, data))
+        return 1;
+    std::cout << "nTraining is " << data.trainingSamples() << "\n"
+              << "nTesting is " << data.testingSamples() << std::endl;
+
+    // Step 3. setup network, same layers as LearnTask
+    OpenANN::RandomNumberGenerator().seed(config.randSeed);
+    ClossNet *clossNet = nullptr;
+    std::unique_ptr<Net> network = createNetwork(config, &clossNet);
+    data.useTraining(*network);
+    network->initialize();
+
+    // Step 4. train
+    std::unique_ptr<OpenANN::Optimizer> opt = createOptimizer(config, *network);
+    opt->setOptimizable(*network);
+    opt->setStopCriteria(config.stoppingCriteria);
+    std::cout << "Optimizer: " << opt->name() << std::endl;
+
+    std::ofstream metrics(config.metricsPath);
+    if (!metrics) {
+        std::cerr << "Cannot write metrics file " << config.metricsPath << std::endl;
+        return 1;
+    }
+    metrics << "iteration,seconds,train_error,test_error,train_rate,test_rate\n";
+
+#ifdef CLOSS_PROFILE
+    Profiler::instance().reset();
+    Profiler::instance().setTracing(!config.profilePath.empty());
+#else
+    if (!config.profilePath.empty())
+        std::cerr << "Profiling is disabled, configure with -DCLOSS_PROFILE=ON "
+                  << "to write " << config.profilePath << std::endl;
+#endif
+
+    OpenANN::StoppingInterrupt interrupt;
+    const auto start = std::chrono::steady_clock::now();
+    int iter = 0;
+    while (opt->step()) {
+        const double seconds = std::chrono::duration<double>(
+                    std::chrono::steady_clock::now() - start).count();
+        const double trainError = network->error();
+        data.useTesting(*network);
+        const double testError = data.testingSamples() ? network->error() : 0.0;
+        data.useTraining(*network);
+        const double trainRate = data.trainingRate(*network);
+        const double testRate = data.testingRate(*network);
+
+        metrics << iter << "," << seconds << "," << trainError << "," << testError
+                << "," << trainRate << "," << testRate << std::endl;
+        std::cout << "Iteration " << iter << ": train error " << trainError
+                  << ", test rate " << testRate << "%" << std::endl;
+        iter++;
+
+        if (interrupt.isSignaled()) {
+            std::cout << "Training interrupted" << std::endl;
+            break;
+        }
+    }
+    opt->result();
+
+#ifdef CLOSS_PROFILE
+    Profiler::instance().report(std::cout);
+    if (!config.profilePath.empty()) {
+        if (Profiler::instance().writeTrace(config.profilePath))
+            std::cout << "Trace written to " << config.profilePath << std::endl;
+        else
+            std::cerr << "Cannot write trace file " << config.profilePath << std::endl;
+    }
+#endif
+
+    // Step 5. save model
+    const bool binary = clossNet && config.binaryModel;
+    std::ofstream model(config.modelPath, binary ? std::ios::binary : std::ios::out);
+    if (!model) {
+        std::cerr << "Cannot write model file " << config.modelPath << std::endl;
+        return 1;
+    }
+    if (clossNet)
+        clossNet->save(model, binary ? ClossNet::BINARY : ClossNet::TEXT);
+    else
+        network->save(model);
+    std::cout << "Model written to " << config.modelPath << std::endl;
+    return 0;
+}
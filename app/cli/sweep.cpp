@@ -0,0 +1,250 @@
+#include "sweepspec.h"
+#include "trainconfig.h"
+#include "trainer.h"
+#include "WorkerPool.h"
+#include <OpenANN/OpenANN>
+#include <OpenANN/optimization/StoppingInterrupt.h>
+#include <OpenANN/util/Random.h>
+#include <Eigen/Core>
+#include <algorithm>
+#include <chrono>
+#include <exception>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+using Eigen::MatrixXd;
+using OpenANN::Net;
+using namespace Trainer;
+
+namespace {
+
+struct Result
+{
+    int job;
+    bool ok;
+    double trainError, testError, trainRate, testRate, seconds;
+    int iterations;
+};
+
+void usage(const char *program)
+{
+    std::cerr << "Usage: " << program << " <config> <sweep> [key=value]...\n"
+              << "Trains every configuration of the sweep file on top of the "
+              << "config and ranks them by test classification rate. 'threads' "
+              << "sets the number of trainings that run at once, each training "
+              << "uses one thread.\n";
+}
+
+/**
+ * OpenANN's RandomNumberGenerator is one global generator. Everything that
+ * draws from it (seeding, weight initialization and the shuffle seed of
+ * MiniBatchOptimizer) happens under this mutex, so every job starts from
+ * the same state as a ClossTrain run with the same randSeed.
+ */
+std::mutex randomMutex;
+
+bool runJob(const TrainConfig &config, MatrixXd &trainingIn, MatrixXd &trainingOut,
+            MatrixXd &testingIn, MatrixXd &testingOut,
+            OpenANN::StoppingInterrupt &interrupt, Result &result)
+{
+    std::unique_ptr<Net> network;
+    std::unique_ptr<OpenANN::Optimizer> opt;
+    {
+        std::lock_guard<std::mutex> lock(randomMutex);
+        OpenANN::RandomNumberGenerator().seed(config.randSeed);
+        network = createNetwork(config);
+        network->trainingSet(trainingIn, trainingOut);
+        network->initialize();
+        opt = createOptimizer(config, *network);
+        opt->setOptimizable(*network);
+        opt->setStopCriteria(config.stoppingCriteria);
+    }
+
+    const auto start = std::chrono::steady_clock::now();
+    result.iterations = 0;
+    while (opt->step()) {
+        result.iterations++;
+        if (interrupt.isSignaled())
+            return false;
+    }
+    opt->result();
+    result.seconds = std::chrono::duration<double>(
+                         std::chrono::steady_clock::now() - start).count();
+
+    result.trainError = network->error();
+    network->trainingSet(testingIn, testingOut);
+    result.testError = testingIn.rows() ? network->error() : 0.0;
+    network->trainingSet(trainingIn, trainingOut);
+    result.trainRate = classificationRate(*network, trainingIn, trainingOut);
+    result.testRate = classificationRate(*network, testingIn, testingOut);
+    return true;
+}
+
+std::string describe(const std::vector<std::string> &entries)
+{
+    std::string text;
+    for (const std::string &entry : entries)
+        text += (text.empty() ? "" : ", ") + entry;
+    return text;
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+    if (argc < 3) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    // Step 1. read base configuration and search space
+    TrainConfig base;
+    std::string error;
+    std::ifstream configFile(argv[1]);
+    if (!configFile) {
+        std::cerr << "Cannot open config file " << argv[1] << std::endl;
+        return 1;
+    }
+    if (!base.read(configFile, error)) {
+        std::cerr << argv[1] << ": " << error << std::endl;
+        return 1;
+    }
+    for (int i = 3; i < argc; i++) {
+        std::string entry(argv[i]);
+        const size_t eq = entry.find('=');
+        if (eq != std::string::npos)
+            entry[eq] = ' ';
+        if (!base.set(entry, error)) {
+            std::cerr << argv[i] << ": " << error << std::endl;
+            return 1;
+        }
+    }
+    SweepSpec spec;
+    std::ifstream sweepFile(argv[2]);
+    if (!sweepFile) {
+        std::cerr << "Cannot open sweep file " << argv[2] << std::endl;
+        return 1;
+    }
+    if (!spec.read(sweepFile, error)) {
+        std::cerr << argv[2] << ": " << error << std::endl;
+        return 1;
+    }
+
+    // all trainings share the data set, reject entries that would change it
+    const std::vector<std::vector<std::string> > jobs = spec.configurations();
+    std::vector<TrainConfig> configs;
+    for (const auto &entries : jobs) {
+        TrainConfig config = base;
+        for (const std::string &entry : entries) {
+            if (!config.set(entry, error)) {
+                std::cerr << argv[2] << ": " << entry << ": " << error << std::endl;
+                return 1;
+            }
+        }
+        if (config.csvFilePath != base.csvFilePath || config.nInput != base.nInput
+            || config.outputLayer.nUnit != base.outputLayer.nUnit) {
+            std::cerr << argv[2] << ": csvFilePath, input and output "
+                      << "can not be swept" << std::endl;
+            return 1;
+        }
+        if (!config.validate(error)) {
+            std::cerr << argv[1] << ": " << error << std::endl;
+            return 1;
+        }
+        if (config.streamChunk > 0) {
+            std::cerr << argv[1] << ": streamChunk is not supported, all "
+                      << "trainings share the data in memory" << std::endl;
+            return 1;
+        }
+        config.threads = 1;
+        configs.push_back(config);
+    }
+
+    // Step 2. setup data source
+    MatrixXd trainingIn, trainingOut, testingIn, testingOut;
+    if (!loadCSV(base, trainingIn, trainingOut, testingIn, testingOut))
+        return 1;
+    std::cout << "nTraining is " << trainingIn.rows() << "\n"
+              << "nTesting is " << testingIn.rows() << std::endl;
+
+    // Step 3. train, one job per thread
+    WorkerPool pool(base.threads);
+    std::cout << "Training " << configs.size() << " configurations on "
+              << pool.threads() << " threads" << std::endl;
+
+    OpenANN::StoppingInterrupt interrupt;
+    std::vector<Result> results(configs.size());
+    std::mutex outputMutex;
+    int finished = 0;
+    const auto start = std::chrono::steady_clock::now();
+    pool.run(configs.size(), [&](int job) {
+        Result &result = results[job];
+        result.job = job;
+        result.ok = false;
+        if (interrupt.isSignaled())
+            return;
+        std::string failure;
+        try {
+            result.ok = runJob(configs[job], trainingIn, trainingOut, testingIn,
+                               testingOut, interrupt, result);
+        } catch (const std::exception &e) {
+            failure = e.what();
+        }
+
+        std::lock_guard<std::mutex> lock(outputMutex);
+        finished++;
+        std::cout << "[" << finished << "/" << configs.size() << "] "
+                  << describe(jobs[job]);
+        if (result.ok)
+            std::cout << ": test rate " << result.testRate << "%";
+        else
+            std::cout << ": " << (failure.empty() ? "interrupted" : failure);
+        std::cout << std::endl;
+    });
+    if (interrupt.isSignaled())
+        std::cout << "Sweep interrupted, unfinished configurations are not ranked" << std::endl;
+    std::cout << "Sweep took " << std::chrono::duration<double>(
+                  std::chrono::steady_clock::now() - start).count()
+              << " seconds" << std::endl;
+
+    // Step 4. rank by test rate, test error breaks ties
+    std::vector<Result> ranked;
+    for (const Result &result : results) {
+        if (result.ok)
+            ranked.push_back(result);
+    }
+    std::stable_sort(ranked.begin(), ranked.end(), [](const Result &a, const Result &b) {
+        if (a.testRate != b.testRate)
+            return a.testRate > b.testRate;
+        return a.testError < b.testError;
+    });
+
+    std::ofstream table(spec.tablePath);
+    if (!table) {
+        std::cerr << "Cannot write result table " << spec.tablePath << std::endl;
+        return 1;
+    }
+    table << "rank,test_rate,train_rate,test_error,train_error,iterations,seconds";
+    for (const SweepSpec::Axis &axis : spec.axes)
+        table << "," << axis.key;
+    table << "\n";
+    for (size_t r = 0; r != ranked.size(); r++) {
+        const Result &result = ranked[r];
+        table << r + 1 << "," << result.testRate << "," << result.trainRate << ","
+              << result.testError << "," << result.trainError << ","
+              << result.iterations << "," << result.seconds;
+        for (const std::string &entry : jobs[result.job])
+            table << "," << entry.substr(entry.find(' ') + 1);
+        table << "\n";
+    }
+    std::cout << "Results of " << ranked.size() << " configurations written to "
+              << spec.tablePath << std::endl;
+    if (!ranked.empty())
+        std::cout << "Best: " << describe(jobs[ranked[0].job]) << ", test rate "
+                  << ranked[0].testRate << "%" << std::endl;
+    return 0;
+}
@@ -0,0 +1,122 @@
+#include "sweepspec.h"
+#include <istream>
+#include <random>
+#include <sstream>
+
+namespace {
+
+std::string trimmed(const std::string &text)
+{
+    const size_t first = text.find_first_not_of(" \t\r");
+    if (first == std::string::npos)
+        return std::string();
+    const size_t last = text.find_last_not_of(" \t\r");
+    return text.substr(first, last - first + 1);
+}
+
+/**
+ * Append value or, if it is a range "first..last", all integers of it.
+ */
+bool addValue(const std::string &value, std::vector<std::string> &values)
+{
+    const size_t dots = value.find("..");
+    if (dots == std::string::npos) {
+        values.push_back(value);
+        return true;
+    }
+    std::istringstream first(value.substr(0, dots)), last(value.substr(dots + 2));
+    long long from, to;
+    if (!(first >> from) || !(last >> to) || from > to)
+        return false;
+    for (long long v = from; v <= to; v++)
+        values.push_back(std::to_string(v));
+    return true;
+}
+
+} // namespace
+
+SweepSpec::SweepSpec()
+    : samples(0)
+    , searchSeed(0)
+    , tablePath("sweep.csv")
+{
+}
+
+bool SweepSpec::read(std::istream &in, std::string &error)
+{
+    std::string line;
+    int lineNumber = 0;
+    while (std::getline(in, line)) {
+        lineNumber++;
+        const size_t comment = line.find('#');
+        if (comment != std::string::npos)
+            line.erase(comment);
+        line = trimmed(line);
+        if (line.empty())
+            continue;
+
+        std::istringstream entry(line);
+        std::string key;
+        entry >> key;
+        bool ok = true;
+        if (key == "random") {
+            ok = (entry >> samples) && samples > 0;
+            if (ok && !(entry >> std::ws).eof())
+                ok = bool(entry >> searchSeed);
+        } else if (key == "table") {
+            ok = bool(entry >> tablePath);
+        } else {
+            Axis axis;
+            axis.key = key;
+            std::string value;
+            while (ok && std::getline(entry, value, '|'))
+                ok = addValue(trimmed(value), axis.values);
+            ok = ok && !axis.values.empty();
+            axes.push_back(axis);
+        }
+
+        if (!ok) {
+            std::ostringstream msg;
+            msg << "line " << lineNumber << ": invalid values for '" << key << "'";
+            error = msg.str();
+            return false;
+        }
+    }
+    return true;
+}
+
+std::vector<std::vector<std::string> > SweepSpec::configurations() const
+{
+    std::vector<std::vector<std::string> > result;
+    if (samples > 0) {
+        std::mt19937 rng(searchSeed);
+        for (int s = 0; s != samples; s++) {
+            std::vector<std::string> entries;
+            for (const Axis &axis : axes) {
+                std::uniform_int_distribution<size_t> index(0, axis.values.size() - 1);
+                entries.push_back(axis.key + " " + axis.values[index(rng)]);
+            }
+            result.push_back(entries);
+        }
+        return result;
+    }
+
+    // full grid, the last axis changes fastest
+    std::vector<size_t> index(axes.size(), 0);
+    while (true) {
+        std::vector<std::string> entries;
+        for (size_t a = 0; a != axes.size(); a++)
+            entries.push_back(axes[a].key + " " + axes[a].values[index[a]]);
+        result.push_back(entries);
+
+        int a = axes.size() - 1;
+        for (; a >= 0; a--) {
+            if (++index[a] != axes[a].values.size())
+                break;
+            index[a] = 0;
+        }
+        if (a < 0)
+            break;
+    }
+    return result;
+}
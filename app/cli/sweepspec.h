@@ -0,0 +1,55 @@
+#ifndef SWEEPSPEC_H
+#define SWEEPSPEC_H
+
+#include <iosfwd>
+#include <string>
+#include <vector>
+
+/**
+ * Search space of ClossSweep.
+ *
+ * Each line names a TrainConfig key and lists its values separated by '|',
+ * integer ranges "first..last" are expanded. '#' starts a comment:
+ *
+ * \code
+ * kernelSize 0.3 | 0.5 | 1
+ * pValue 1 | 1.5 | 2
+ * layers 20 tanh 20 tanh | 10 tanh
+ * randSeed 1..100
+ * random 500 7     # optional: 500 random configurations, search seed 7
+ * table sweep.csv  # result table, default sweep.csv
+ * \endcode
+ *
+ * Without "random" the full grid is searched.
+ */
+struct SweepSpec
+{
+    struct Axis
+    {
+        std::string key;
+        std::vector<std::string> values;
+    };
+
+    SweepSpec();
+
+    /**
+     * Read the search space from a stream.
+     * @param error receives a description of the first invalid line
+     * @return false if a line is invalid
+     */
+    bool read(std::istream &in, std::string &error);
+
+    /**
+     * @return the configurations to train, each one holds one
+     *         "key value..." entry per axis
+     */
+    std::vector<std::vector<std::string> > configurations() const;
+
+    std::vector<Axis> axes;
+    // number of random samples, 0 searches the full grid
+    int samples;
+    unsigned int searchSeed;
+    std::string tablePath;
+};
+
+#endif // SWEEPSPEC_H
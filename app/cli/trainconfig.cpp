@@ -0,0 +1,165 @@
+#include "trainconfig.h"
+#include <istream>
+#include <sstream>
+
+namespace {
+
+bool parseActivation(const std::string &name, ActivationFunction &act)
+{
+    static const char *names[] = {
+        "logistic", "tanh", "tanh_scaled", "rectifier", "linear"
+    };
+    for (int i = 0; i != sizeof(names) / sizeof(names[0]); i++) {
+        if (name == names[i]) {
+            act = (ActivationFunction) i;
+            return true;
+        }
+    }
+    return false;
+}
+
+bool parseLayer(std::istream &in, TrainConfig::Layer &layer)
+{
+    std::string act;
+    return (in >> layer.nUnit >> act) && layer.nUnit > 0
+           && parseActivation(act, layer.activationFunc);
+}
+
+} // namespace
+
+TrainConfig::TrainConfig()
+    : errorFunc(Closs)
+    , kernelSize(0.5)
+    , pValue(2.0)
+    , randSeed(0)
+    , optimizer(LMA)
+    , learningRate(0.01)
+    , batchSize(32)
+    , threads(0)
+    , singlePrecision(false)
+    , streamChunk(0)
+    , nInput(0)
+    , outputLayer{0, OpenANN::TANH}
+    , modelPath("model.net")
+    , binaryModel(true)
+    , metricsPath("metrics.csv")
+{
+}
+
+bool TrainConfig::read(std::istream &in, std::string &error)
+{
+    std::string line;
+    int lineNumber = 0;
+    while (std::getline(in, line)) {
+        lineNumber++;
+        const size_t comment = line.find('#');
+        if (comment != std::string::npos)
+            line.erase(comment);
+        if (line.find_first_not_of(" \t\r") == std::string::npos)
+            continue;
+        if (!set(line, error)) {
+            std::ostringstream msg;
+            msg << "line " << lineNumber << ": " << error;
+            error = msg.str();
+            return false;
+        }
+    }
+    return true;
+}
+
+bool TrainConfig::set(const std::string &line, std::string &error)
+{
+    std::istringstream in(line);
+    std::string key, value;
+    in >> key;
+
+    bool ok = true;
+    if (key == "csvFilePath") {
+        ok = bool(in >> csvFilePath);
+    } else if (key == "errorFunc") {
+        ok = bool(in >> value) && (value == "closs" || value == "mse");
+        errorFunc = value == "mse" ? MSE : Closs;
+    } else if (key == "kernelSize") {
+        ok = bool(in >> kernelSize) && kernelSize > 0.0;
+    } else if (key == "pValue") {
+        ok = bool(in >> pValue) && pValue > 0.0;
+    } else if (key == "randSeed") {
+        ok = bool(in >> randSeed);
+    } else if (key == "optimizer") {
+        in >> value;
+        if (value == "lma")
+            optimizer = LMA;
+        else if (value == "momentum")
+            optimizer = Momentum;
+        else if (value == "nesterov")
+            optimizer = Nesterov;
+        else if (value == "adam")
+            optimizer = Adam;
+        else
+            ok = false;
+    } else if (key == "learningRate") {
+        ok = bool(in >> learningRate) && learningRate > 0.0;
+    } else if (key == "batchSize") {
+        ok = bool(in >> batchSize) && batchSize > 0;
+    } else if (key == "threads") {
+        ok = bool(in >> threads) && threads >= 0;
+    } else if (key == "precision") {
+        ok = bool(in >> value) && (value == "single" || value == "double");
+        singlePrecision = value == "single";
+    } else if (key == "streamChunk") {
+        ok = bool(in >> streamChunk) && streamChunk >= 0;
+    } else if (key == "input") {
+        ok = bool(in >> nInput) && nInput > 0;
+    } else if (key == "layer") {
+        Layer layer;
+        ok = parseLayer(in, layer);
+        hiddenLayers.push_back(layer);
+    } else if (key == "layers") {
+        // replaces all hidden layers, nothing means no hidden layer
+        hiddenLayers.clear();
+        Layer layer;
+        while (ok && !(in >> std::ws).eof()) {
+            ok = parseLayer(in, layer);
+            hiddenLayers.push_back(layer);
+        }
+    } else if (key == "output") {
+        ok = parseLayer(in, outputLayer);
+    } else if (key == "maximalIterations") {
+        ok = bool(in >> stoppingCriteria.maximalIterations);
+    } else if (key == "minimalValue") {
+        ok = bool(in >> stoppingCriteria.minimalValue);
+    } else if (key == "minimalValueDifferences") {
+        ok = bool(in >> stoppingCriteria.minimalValueDifferences);
+    } else if (key == "minimalSearchSpaceStep") {
+        ok = bool(in >> stoppingCriteria.minimalSearchSpaceStep);
+    } else if (key == "model") {
+        ok = bool(in >> modelPath);
+    } else if (key == "modelFormat") {
+        ok = bool(in >> value) && (value == "binary" || value == "text");
+        binaryModel = value == "binary";
+    } else if (key == "metrics") {
+        ok = bool(in >> metricsPath);
+    } else if (key == "profile") {
+        ok = bool(in >> profilePath);
+    } else {
+        error = "unknown key '" + key + "'";
+        return false;
+    }
+
+    if (!ok)
+        error = "invalid value for '" + key + "'";
+    return ok;
+}
+
+bool TrainConfig::validate(std::string &error) const
+{
+    if (csvFilePath.empty())
+        error = "csvFilePath is required";
+    else if (nInput <= 0)
+        error = "input is required";
+    else if (outputLayer.nUnit <= 0)
+        error = "output is required";
+    else
+        return true;
+    return false;
+}
@@ -0,0 +1,105 @@
+#ifndef TRAINCONFIG_H
+#define TRAINCONFIG_H
+
+#include <OpenANN/ActivationFunctions.h>
+#include <OpenANN/optimization/StoppingCriteria.h>
+#include <iosfwd>
+#include <string>
+#include <vector>
+
+using OpenANN::ActivationFunction;
+using OpenANN::StoppingCriteria;
+
+/**
+ * Headless counterpart of LearnParam.
+ *
+ * The configuration is a text file with one "key value..." entry per line,
+ * '#' starts a comment:
+ *
+ * \code
+ * csvFilePath data.csv
+ * errorFunc closs        # closs or mse
+ * kernelSize 0.5
+ * pValue 2
+ * randSeed 42
+ * optimizer lma          # lma, momentum, nesterov or adam
+ * learningRate 0.01
+ * batchSize 32
+ * threads 0              # 0 uses all hardware threads
+ * precision double       # or single, LMA always computes the Jacobian in double
+ * streamChunk 0          # > 0 streams the CSV in chunks of this many rows
+ * input 2
+ * layer 20 tanh
+ * layer 20 tanh
+ * output 1 tanh
+ * # or all hidden layers in one entry: layers 20 tanh 20 tanh
+ * maximalIterations 100
+ * minimalValueDifferences 1e-10
+ * model trained.net
+ * modelFormat binary    # binary or text, MSE networks are always text
+ * metrics metrics.csv
+ * profile trace.json    # Chrome trace, needs the CMake option CLOSS_PROFILE
+ * \endcode
+ */
+struct TrainConfig
+{
+    struct Layer
+    {
+        int nUnit;
+        ActivationFunction activationFunc;
+    };
+
+    enum ErrorFunction {
+        MSE,
+        Closs
+    };
+
+    enum Optimizer {
+        LMA,
+        Momentum,
+        Nesterov,
+        Adam
+    };
+
+    TrainConfig();
+
+    /**
+     * Read entries from a stream.
+     * @param error receives a description of the first invalid entry
+     * @return false if an entry is invalid
+     */
+    bool read(std::istream &in, std::string &error);
+    /**
+     * Set one entry.
+     * @param line "key value..."
+     * @return false if the entry is invalid
+     */
+    bool set(const std::string &line, std::string &error);
+    /**
+     * @return false if a required entry is missing
+     */
+    bool validate(std::string &error) const;
+
+    std::string csvFilePath;
+    ErrorFunction errorFunc;
+    double kernelSize;
+    double pValue;
+    unsigned int randSeed;
+    Optimizer optimizer;
+    double learningRate;
+    int batchSize;
+    int threads;
+    bool singlePrecision;
+    int streamChunk;
+    int nInput;
+    std::vector<Layer> hiddenLayers;
+    Layer outputLayer;
+    StoppingCriteria stoppingCriteria;
+    std::string modelPath;
+    bool binaryModel;
+    std::string metricsPath;
+    // empty disables the trace
+    std::string profilePath;
+};
+
+#endif // TRAINCONFIG_H
@@ -0,0 +1,178 @@
+#include "trainer.h"
+#include "ClassificationEvaluator.h"
+#include "ClossNet.h"
+#include "CsvLoader.h"
+#include "InterruptableLMA.h"
+#include "MiniBatchOptimizer.h"
+#include "StreamingLMA.h"
+#include <OpenANN/Preprocessing.h>
+#include <OpenANN/util/OpenANNException.h>
+#include <iostream>
+
+using Eigen::MatrixXd;
+using OpenANN::Net;
+
+bool Trainer::loadCSV(const TrainConfig &config, MatrixXd &trainingIn, MatrixXd &trainingOut,
+                      MatrixXd &testingIn, MatrixXd &testingOut)
+{
+    int nTraining = 0;
+    int nTest = 0;
+    try {
+        CsvLoader loader(config.threads);
+        const int nRow = loader.open(config.csvFilePath);
+        nTest = nRow / 2;
+        nTraining = nRow - nTest;
+        trainingIn.resize(nTraining, config.nInput);
+        trainingOut.resize(nTraining, config.outputLayer.nUnit);
+        testingIn.resize(nTest, config.nInput);
+        testingOut.resize(nTest, config.outputLayer.nUnit);
+        loader.read(0, nTraining, trainingIn, trainingOut);
+        loader.read(nTraining, nRow, testingIn, testingOut);
+    } catch (const OpenANN::OpenANNException &e) {
+        std::cerr << "Cannot read CSV file " << config.csvFilePath << ": "
+                  << e.what() << std::endl;
+        return false;
+    }
+
+    if (nTraining)
+        OpenANN::scaleData(trainingIn, -1.5, 1.5);
+    if (nTest)
+        OpenANN::scaleData(testingIn, -1.5, 1.5);
+    return nTraining > 0;
+}
+
+bool Trainer::loadData(const TrainConfig &config, Data &data)
+{
+    if (config.streamChunk == 0)
+        return loadCSV(config, data.trainingIn, data.trainingOut,
+                       data.testingIn, data.testingOut);
+
+    try {
+        const int nRow = StreamingDataSet::open(config.csvFilePath)->rows();
+        const int nTraining = nRow - nRow / 2;
+        const int nOutput = config.outputLayer.nUnit;
+        data.training.reset(new StreamingDataSet(
+                StreamingDataSet::open(config.csvFilePath, config.threads),
+                config.nInput, nOutput, 0, nTraining, config.streamChunk));
+        data.testing.reset(new StreamingDataSet(
+                StreamingDataSet::open(config.csvFilePath, config.threads),
+                config.nInput, nOutput, nTraining, nRow, config.streamChunk));
+        if (data.training->samples())
+            data.training->scaleInputs(-1.5, 1.5);
+        if (data.testing->samples())
+            data.testing->scaleInputs(-1.5, 1.5);
+    } catch (const OpenANN::OpenANNException &e) {
+        std::cerr << "Cannot read CSV file " << config.csvFilePath << ": "
+                  << e.what() << std::endl;
+        return false;
+    }
+    return data.training->samples() > 0;
+}
+
+int Trainer::Data::trainingSamples() const
+{
+    return training ? training->samples() : trainingIn.rows();
+}
+
+int Trainer::Data::testingSamples() const
+{
+    return testing ? testing->samples() : testingIn.rows();
+}
+
+void Trainer::Data::useTraining(Net &net)
+{
+    if (training)
+        net.trainingSet(*training);
+    else
+        net.trainingSet(trainingIn, trainingOut);
+}
+
+void Trainer::Data::useTesting(Net &net)
+{
+    if (testing)
+        net.trainingSet(*testing);
+    else
+        net.trainingSet(testingIn, testingOut);
+}
+
+double Trainer::Data::trainingRate(Net &net)
+{
+    return training ? classificationRate(net, *training)
+           : classificationRate(net, trainingIn, trainingOut);
+}
+
+double Trainer::Data::testingRate(Net &net)
+{
+    return testing ? classificationRate(net, *testing)
+           : classificationRate(net, testingIn, testingOut);
+}
+
+double Trainer::classificationRate(Net &net, const MatrixXd &in, const MatrixXd &out)
+{
+    return ClassificationEvaluator().evaluate(net, in, out).rate;
+}
+
+double Trainer::classificationRate(Net &net, StreamingDataSet &data)
+{
+    return ClassificationEvaluator().evaluate(net, data).rate;
+}
+
+std::unique_ptr<Net> Trainer::createNetwork(const TrainConfig &config, ClossNet **clossNet)
+{
+    std::unique_ptr<Net> network;
+    if (config.errorFunc == TrainConfig::Closs) {
+        ClossNet *net = new ClossNet;
+        network.reset(net);
+        net->setKernelSize(config.kernelSize);
+        net->setPValue(config.pValue);
+        net->setThreads(config.threads);
+        net->setSinglePrecision(config.singlePrecision);
+        net->inputLayer(config.nInput);
+        for (auto layer : config.hiddenLayers)
+            net->bpLayer(layer.nUnit, layer.activationFunc);
+        net->bpLayer(config.outputLayer.nUnit, config.outputLayer.activationFunc);
+        if (clossNet)
+            *clossNet = net;
+    } else {
+        network.reset(new Net);
+        network->inputLayer(config.nInput);
+        for (auto layer : config.hiddenLayers)
+            network->fullyConnectedLayer(layer.nUnit, layer.activationFunc);
+        network->outputLayer(config.outputLayer.nUnit, config.outputLayer.activationFunc);
+        if (clossNet)
+            *clossNet = nullptr;
+    }
+    return network;
+}
+
+std::unique_ptr<OpenANN::Optimizer> Trainer::createOptimizer(const TrainConfig &config, Net &net)
+{
+    MiniBatchOptimizer::Method method = MiniBatchOptimizer::MOMENTUM;
+    switch (config.optimizer) {
+    case TrainConfig::LMA:
+        if (config.streamChunk > 0
+            || sizeof(double) * (double) net.examples() * net.dimension() > MAX_JACOBIAN_BYTES) {
+            auto lma = new StreamingLMA;
+            lma->setThreads(config.threads);
+            lma->setChunkSize(config.streamChunk);
+            return std::unique_ptr<OpenANN::Optimizer>(lma);
+        } else {
+            auto lma = new InterruptableLMA;
+            lma->setThreads(config.threads);
+            return std::unique_ptr<OpenANN::Optimizer>(lma);
+        }
+    case TrainConfig::Momentum:
+        method = MiniBatchOptimizer::MOMENTUM;
+        break;
+    case TrainConfig::Nesterov:
+        method = MiniBatchOptimizer::NESTEROV;
+        break;
+    case TrainConfig::Adam:
+        method = MiniBatchOptimizer::ADAM;
+        break;
+    }
+    auto sgd = new MiniBatchOptimizer(method, config.learningRate, config.batchSize);
+    // streamed chunks are read in order
+    sgd->setShuffleWindow(config.streamChunk);
+    return std::unique_ptr<OpenANN::Optimizer>(sgd);
+}
@@ -0,0 +1,77 @@
+#ifndef TRAINER_H
+#define TRAINER_H
+
+#include "trainconfig.h"
+#include "StreamingDataSet.h"
+#include <OpenANN/Net.h>
+#include <OpenANN/optimization/Optimizer.h>
+#include <Eigen/Core>
+#include <memory>
+
+class ClossNet;
+
+/**
+ * Building blocks shared by ClossTrain and ClossSweep.
+ */
+namespace Trainer {
+
+/**
+ * Same split and scaling as UCWDataSet::generateCSV(): the first half of
+ * the rows is used for training, inputs are scaled to [-1.5, 1.5].
+ */
+bool loadCSV(const TrainConfig &config, Eigen::MatrixXd &trainingIn,
+             Eigen::MatrixXd &trainingOut, Eigen::MatrixXd &testingIn,
+             Eigen::MatrixXd &testingOut);
+
+/**
+ * Training and testing examples, in memory or streamed from disk.
+ */
+struct Data
+{
+    Eigen::MatrixXd trainingIn, trainingOut, testingIn, testingOut;
+    // used instead of the matrices if streamChunk is set
+    std::unique_ptr<StreamingDataSet> training, testing;
+
+    int trainingSamples() const;
+    int testingSamples() const;
+    /**
+     * Set the training or testing examples as training set of net.
+     */
+    void useTraining(OpenANN::Net &net);
+    void useTesting(OpenANN::Net &net);
+    double trainingRate(OpenANN::Net &net);
+    double testingRate(OpenANN::Net &net);
+};
+
+/**
+ * Load the CSV file into memory or, if streamChunk is set, open it as two
+ * StreamingDataSets with the same split and scaling as loadCSV().
+ */
+bool loadData(const TrainConfig &config, Data &data);
+
+/**
+ * Percentage of examples whose outputs all lie within 0.8 of the targets,
+ * see ClassificationEvaluator.
+ */
+double classificationRate(OpenANN::Net &net, const Eigen::MatrixXd &in,
+                          const Eigen::MatrixXd &out);
+double classificationRate(OpenANN::Net &net, StreamingDataSet &data);
+
+/**
+ * Create the layers of LearnTask. The network is not initialized, seed
+ * OpenANN's RandomNumberGenerator before calling initialize().
+ * @param clossNet receives the network if it is a ClossNet, may be null
+ */
+std::unique_ptr<OpenANN::Net> createNetwork(const TrainConfig &config,
+                                            ClossNet **clossNet = nullptr);
+
+/**
+ * Create the configured optimizer, LMA is replaced by StreamingLMA if the
+ * Jacobian of the network would not fit in memory or the data is streamed.
+ */
+std::unique_ptr<OpenANN::Optimizer> createOptimizer(const TrainConfig &config,
+                                                    OpenANN::Net &net);
+
+} // namespace Trainer
+
+#endif // TRAINER_H
@@ -1,2 +0,0 @@
-# QtAwesome
-include_directories(libs/fast-cpp-csv-parser/)
@@ -0,0 +1,81 @@
+#include "evaluator.h"
+#include "models/learntask.h"
+#include "models/ucwdataset.h"
+#include <OpenANN/OpenANN>
+
+Evaluator::Evaluator(LearnTask *task, QObject *parent)
+    : QObject(parent)
+    , task_(task)
+    , network_(task->createNetwork())
+    , classifier_(task->parameters().kernelSize(), task->parameters().pValue())
+    , closs_(task->parameters().errorFunc() == LearnParam::Closs)
+    , pendingIteration_(-1)
+    , busy_(false)
+    , stop_(false)
+    , skipped_(0)
+{
+    network_->initialize();
+    worker_ = std::thread(&Evaluator::work, this);
+}
+
+Evaluator::~Evaluator()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stop_ = true;
+    }
+    condition_.notify_all();
+    worker_.join();
+}
+
+void Evaluator::submit(int iteration, const Eigen::VectorXd &parameters)
+{
+    // copy outside of the lock, the worker never waits for the optimizer
+    Snapshot snapshot = std::make_shared<const Eigen::VectorXd>(parameters);
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (pending_)
+            ++skipped_;
+        pending_ = std::move(snapshot);
+        pendingIteration_ = iteration;
+    }
+    condition_.notify_all();
+}
+
+void Evaluator::finish()
+{
+    std::unique_lock<std::mutex> lock(mutex_);
+    condition_.wait(lock, [this] { return !pending_ && !busy_; });
+}
+
+int Evaluator::skipped()
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return skipped_;
+}
+
+void Evaluator::work()
+{
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (true) {
+        condition_.wait(lock, [this] { return pending_ || stop_; });
+        if (stop_)
+            break;
+
+        Snapshot snapshot = std::move(pending_);
+        const int iteration = pendingIteration_;
+        busy_ = true;
+        lock.unlock();
+
+        network_->setParameters(*snapshot);
+        auto test = classifier_.evaluate(*network_, task_->data().testing());
+        auto train = classifier_.evaluate(*network_, task_->data().training());
+        // error of the function the network is trained with
+        double error = closs_ ? train.closs : train.mse;
+        emit evaluated(iteration, error, train.rate, test.rate);
+
+        lock.lock();
+        busy_ = false;
+        condition_.notify_all();
+    }
+}
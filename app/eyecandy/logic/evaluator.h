@@ -0,0 +1,80 @@
+#ifndef EVALUATOR_H
+#define EVALUATOR_H
+
+#include "ClassificationEvaluator.h"
+#include <QObject>
+#include <Eigen/Core>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+class LearnTask;
+namespace OpenANN {
+class Net;
+}
+using OpenANN::Net;
+
+/**
+ * Computes the classification rates and the training error of a LearnTask
+ * on a worker thread.
+ *
+ * The optimizer thread submits a snapshot of the parameters after each
+ * iteration and continues immediately. Snapshots are immutable and shared
+ * by reference count, the worker evaluates them with its own copy of the
+ * network. Only the latest snapshot waits for the worker, an older one that
+ * was not started yet is skipped.
+ */
+class Evaluator : public QObject
+{
+    Q_OBJECT
+public:
+    using Snapshot = std::shared_ptr<const Eigen::VectorXd>;
+
+    /**
+     * Must be created before the random seed of the training is set,
+     * initializing the private network draws random numbers.
+     */
+    explicit Evaluator(LearnTask *task, QObject *parent = 0);
+    virtual ~Evaluator();
+
+    /**
+     * Queue the parameters of an iteration, replaces a queued snapshot.
+     */
+    void submit(int iteration, const Eigen::VectorXd &parameters);
+    /**
+     * Wait until the queued snapshot is evaluated.
+     */
+    void finish();
+    /**
+     * @return number of snapshots that were replaced before evaluation
+     */
+    int skipped();
+
+signals:
+    /**
+     * Emitted from the worker thread.
+     * @param error mean Closs or MSE of the training set, depending on the
+     *              error function of the task
+     */
+    void evaluated(int iteration, double error, double trainRate, double testRate);
+
+private:
+    void work();
+
+    LearnTask *task_;
+    std::unique_ptr<Net> network_;
+    ClassificationEvaluator classifier_;
+    bool closs_;
+
+    std::mutex mutex_;
+    std::condition_variable condition_;
+    Snapshot pending_;
+    int pendingIteration_;
+    bool busy_;
+    bool stop_;
+    int skipped_;
+    std::thread worker_;
+};
+
+#endif // EVALUATOR_H
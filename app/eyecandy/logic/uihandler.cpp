@@ -1,17 +1,18 @@
 #include "ClossNet.h"
 #include "InterruptableLMA.h"
+#include "MiniBatchOptimizer.h"
+#include "StreamingLMA.h"
 #include "uihandler.h"
+#include "evaluator.h"
 #include "models/learnparam.h"
 #include "models/learntask.h"
 #include "models/ucwdataset.h"
 #include "utils/logger.h"
 #include <OpenANN/OpenANN>
-#include <OpenANN/optimization/MBSGD.h>
 #include <OpenANN/io/Logger.h>
 #include <OpenANN/util/Random.h>
 #include <QFuture>
 #include <QtConcurrent/QtConcurrent>
-#include <QVariantMap>
 #include <QReadLocker>
 #include <QWriteLocker>
 #include <QMutexLocker>
@@ -25,7 +26,9 @@ UIHandler::UIHandler(QObject *parent)
     , running_(false)
     , configured_(false)
     , task(nullptr)
+    , prediction(30, 0.0, 1.0, 0)
 {
+    PlotData::registerMetaType();
     connect(this, &UIHandler::iterationFinished,
             this, &UIHandler::onIterationFinished);
     connect(&futureWatcher, &QFutureWatcher<void>::finished,
@@ -87,6 +90,14 @@ void UIHandler::run()
 {
     if (!configured_) return;
 
+    // evaluates the rates while the optimizer continues, its network
+    // has to be initialized before the seed is set
+    Evaluator evaluator(task);
+    connect(&evaluator, &Evaluator::evaluated,
+    this, [this](int iter, double error, double trainRate, double testRate) {
+        emit iterationFinished(task, iter, error, trainRate, testRate);
+    }, Qt::DirectConnection);
+
     // set random seed
     RandomNumberGenerator().seed(task->parameters().randSeed());
 
@@ -94,55 +105,55 @@ void UIHandler::run()
     task->network().initialize();
     Log::normal() << "网络初始化完成";
 
-//    InterruptableLMA opt;
-    OpenANN::Optimizer *opt;
-    switch (task->parameters().errorFunc()) {
-    case LearnParam::MSE:
-    case LearnParam::Closs:
-        opt = new InterruptableLMA();
+    OpenANN::Optimizer *opt = nullptr;
+    const LearnParam &param = task->parameters();
+    switch (param.optimizer()) {
+    case LearnParam::LMA:
+    {
+        Log::warning() << "Learning rate not support in LMA!";
+        // the dense Jacobian of large data sets does not fit into memory
+        const double jacobianBytes = sizeof(double) * (double) task->network().examples()
+                                     * task->network().dimension();
+        if (jacobianBytes > MAX_JACOBIAN_BYTES) {
+            Log::info() << "Jacobian too large, using streaming LMA";
+            auto lma = new StreamingLMA();
+            lma->setThreads(0);
+            opt = lma;
+        } else {
+            auto lma = new InterruptableLMA();
+            // evaluate the Jacobian on all cores
+            lma->setThreads(0);
+            opt = lma;
+        }
         break;
-        opt = new OpenANN::MBSGD;
+    }
+    case LearnParam::Momentum:
+        opt = new MiniBatchOptimizer(MiniBatchOptimizer::MOMENTUM,
+                                     param.learningRate(), param.batchSize());
+        break;
+    case LearnParam::Nesterov:
+        opt = new MiniBatchOptimizer(MiniBatchOptimizer::NESTEROV,
+                                     param.learningRate(), param.batchSize());
+        break;
+    case LearnParam::Adam:
+        opt = new MiniBatchOptimizer(MiniBatchOptimizer::ADAM,
+                                     param.learningRate(), param.batchSize());
         break;
     }
 
     opt->setOptimizable(task->network());
     opt->setStopCriteria(task->stopCriteria());
-    Log::warning() << "Learning rate not support in LMA!";
-
-    // protect multithread access to data
-    auto step = [&]() {
-        // ensure data is in training mode
-        auto ctx = task->data().enterTrainingMode(false);
-        task->network().trainingSet(task->data());
-        return opt->step();
-    };
 
     int iter = 0;
-    while(step())
+    while(opt->step())
     {
         if (predictionInRequest) {
             generatePrediction(task->network());
             predictionInRequest = false;
         }
 
-        // compute testing error, testing rate and train rate
-        double testRate = 0.0;
-        double trainRate = 0.0;
-        {
-            auto ctx = task->data().enterTestingMode(false);
-            task->network().trainingSet(task->data());
-            testRate = computeClassificationPossibility();
-        }
-        {
-            auto ctx = task->data().enterTrainingMode(false);
-            task->network().trainingSet(task->data());
-            trainRate = computeClassificationPossibility();
-        }
-
-        emit iterationFinished(task, iter++,
-                               0,
-                               trainRate,
-                               testRate);
+        // testing rate and train rate are emitted by the evaluator
+        evaluator.submit(iter++, task->network().currentParameters());
 
         QReadLocker locker(&lockForCancelFlag);
         if(cancelFlag) {
@@ -152,6 +163,10 @@ void UIHandler::run()
     }
     opt->result();
     delete opt;
+
+    evaluator.finish();
+    if (evaluator.skipped())
+        Log::info() << "跳过了 " << evaluator.skipped() << " 次迭代的评估";
 }
 
 void UIHandler::onTrainingFinished()
@@ -187,97 +202,34 @@ void UIHandler::requestPredictionAsync()
     requestPrediction(true);
 }
 
-QVariantList UIHandler::getTrainingSet()
+PlotData UIHandler::getTrainingSet()
 {
-    QVariantList data;
-    bool oldMode = task->data().inTrainingMode();
-    task->data().inTrainingMode(true);
-    int n = task->data().samples();
-    for (int i = 0; i!= n; i++)
-    {
-        auto in = task->data().getInstance(i);
-        auto out = task->data().getTarget(i);
-
-        QVariantList point;
-        point << in(0) << out(0) << in(1);
-        data << QVariant(point);
-    }
-
-    task->data().inTrainingMode(oldMode);
-    return data;
+    auto &view = task->data().training();
+    return PlotData::scatter(view.input(), view.output());
 }
 
-QVariantList UIHandler::getTestingSet()
+PlotData UIHandler::getTestingSet()
 {
-    QVariantList data;
-    bool oldMode = task->data().inTrainingMode();
-    task->data().inTrainingMode(false);
-    int n = task->data().samples();
-    for (int i = 0; i!= n; i++)
-    {
-        auto in = task->data().getInstance(i);
-        auto out = task->data().getTarget(i);
-
-        QVariantList point;
-        point << in(0) << out(0) << in(1);
-        data << QVariant(point);
-    }
-
-    task->data().inTrainingMode(oldMode);
-    return data;
+    auto &view = task->data().testing();
+    return PlotData::scatter(view.input(), view.output());
 }
 
 void UIHandler::onIterationFinished()
 {
 }
 
-void UIHandler::generatePrediction(Learner& learner)
+void UIHandler::setPredictionResolution(int resolution)
 {
-    int n = 30;
-    auto range = task->data().inputRange();
-    auto step = (range.second - range.first) / n;
-    QVariantList prediction;
-    for(int x = 0; x < n; x++)
-    {
-        for(int y = 0; y < n; y++)
-        {
-            double xx = range.first + step * x;
-            double yy = range.first + step * y;
-            Eigen::VectorXd in(2);
-            in << xx, yy;
-            Eigen::VectorXd out = learner(in);
-            QVariantList point;
-            point << xx << out(0, 0) << yy;
-            prediction << QVariant(point);
-        }
-    }
-    emit predictionUpdated(prediction);
+    prediction.setResolution(resolution);
 }
 
-double UIHandler::computeClassificationPossibility()
+void UIHandler::generatePrediction(Learner& learner)
 {
-    int correct = task->data().samples();
-    if (!correct) {
-        Log::warning() << "computeClassificationPossibility: "
-                        <<"No samples in dataset";
-        return 0.0;
-    }
+    auto range = task->data().inputRange();
+    prediction.setRange(range.first, range.second);
+    prediction.compute(learner);
 
-    for (int i = 0; i!= task->data().samples(); i++) {
-        auto in = task->data().getInstance(i);
-        auto desired = task->data().getTarget(i);
-        auto out = task->network()(in);
-
-        bool m = match(out, desired);
-        /*
-        std::cout << "In(" << in << ") Desired (" << desired
-                  << ") Out (" << out << ") ----- " << (m ? "Match" : "Not Match")
-                  << std::endl;
-        */
-        if (!m) --correct;
-    }
-    double rate = correct * 100.0 / (double) task->data().samples();
-    return rate;
+    emit predictionUpdated(PlotData::plane(prediction));
 }
 
 void UIHandler::sendTrainingDataUpdated()
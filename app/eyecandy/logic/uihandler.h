@@ -1,10 +1,11 @@
 #ifndef UIHANDLER_H
 #define UIHANDLER_H
 
+#include "PredictionPlane.h"
+#include "models/plotdata.h"
 #include <QObject>
 #include <QReadWriteLock>
 #include <QFutureWatcher>
-#include <QVariantList>
 
 class ClossNet;
 class LearnTask;
@@ -15,11 +16,6 @@ class QQmlEngine;
 class QJSEngine;
 QT_END_NAMESPACE
 
-namespace OpenANN {
-class Learner;
-}
-using OpenANN::Learner;
-
 class UIHandler : public QObject
 {
     Q_OBJECT
@@ -36,17 +32,28 @@ public slots:
     void dispose();
     void requestPrediction(bool async = true);
     void requestPredictionAsync();
+    /**
+     * Set number of grid points along each input of the prediction plane.
+     * Must not be called while training.
+     */
+    void setPredictionResolution(int resolution);
 
     inline bool configured() const { return configured_; }
     inline bool training() const { return running_; }
 
-    QVariantList getTrainingSet();
-    QVariantList getTestingSet();
+    PlotData getTrainingSet();
+    PlotData getTestingSet();
 
 signals:
-    void predictionUpdated(QVariantList data);
-    void trainingDataUpdated(QVariantList data);
-    void testingDataUpdated(QVariantList data);
+    /**
+     * @param plane a PlotData::Plane
+     */
+    void predictionUpdated(PlotData plane);
+    /**
+     * @param data a PlotData::Scatter
+     */
+    void trainingDataUpdated(PlotData data);
+    void testingDataUpdated(PlotData data);
     void iterationFinished(LearnTask *task, int iter, double error, double trainRate, double testRate);
     void inputRangeUpdated(double min, double max);
     void outputRangeUpdated(double min, double max, int labelsCount);
@@ -57,9 +64,6 @@ protected slots:
     void onIterationFinished();
     void generatePrediction(Learner& learner);
 
-protected:
-    double computeClassificationPossibility();
-
 private:
     void sendTrainingDataUpdated();
     void sendTestingDataUpdated();
@@ -75,6 +79,7 @@ private:
     // neural network related
     bool configured_;
     LearnTask *task;
+    PredictionPlane prediction;
 
     // async task handling
     QFutureWatcher<void> futureWatcher;
@@ -0,0 +1,181 @@
+#include "csvcache.h"
+#include "utils/logger.h"
+#include <QByteArray>
+#include <QCryptographicHash>
+#include <QDataStream>
+#include <QDateTime>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QStandardPaths>
+#include <QSysInfo>
+
+using Eigen::MatrixXd;
+
+namespace {
+
+const quint32 CACHE_MAGIC = 0x55435743; // "UCWC"
+const quint32 CACHE_VERSION = 1;
+// the matrices start at a multiple of this offset
+const qint64 CACHE_ALIGNMENT = 64;
+
+struct CacheHeader
+{
+    quint32 magic = CACHE_MAGIC;
+    quint32 version = CACHE_VERSION;
+    // payload is in host byte order, the cache is never shared
+    quint8 littleEndian = QSysInfo::ByteOrder == QSysInfo::LittleEndian;
+    qint64 payloadOffset = 0;
+    QString sourcePath;
+    qint64 sourceModified = 0;
+    qint64 sourceSize = 0;
+    qint32 nInput = 0;
+    qint32 nOutput = 0;
+    qint32 nTraining = 0;
+    qint32 nTest = 0;
+};
+
+QDataStream &operator<<(QDataStream &out, const CacheHeader &h)
+{
+    return out << h.magic << h.version << h.littleEndian << h.payloadOffset
+               << h.sourcePath << h.sourceModified << h.sourceSize
+               << h.nInput << h.nOutput << h.nTraining << h.nTest;
+}
+
+QDataStream &operator>>(QDataStream &in, CacheHeader &h)
+{
+    in >> h.magic >> h.version;
+    if (h.magic != CACHE_MAGIC || h.version != CACHE_VERSION) {
+        in.setStatus(QDataStream::ReadCorruptData);
+        return in;
+    }
+    return in >> h.littleEndian >> h.payloadOffset
+           >> h.sourcePath >> h.sourceModified >> h.sourceSize
+           >> h.nInput >> h.nOutput >> h.nTraining >> h.nTest;
+}
+
+QByteArray serialize(const CacheHeader &header)
+{
+    QByteArray bytes;
+    QDataStream out(&bytes, QIODevice::WriteOnly);
+    out.setVersion(QDataStream::Qt_5_0);
+    out.setByteOrder(QDataStream::LittleEndian);
+    out << header;
+    return bytes;
+}
+
+void writeMatrix(QSaveFile &file, const MatrixXd &m)
+{
+    file.write(reinterpret_cast<const char *>(m.data()), m.size() * sizeof(double));
+}
+
+} // namespace
+
+CSVCache::CSVCache(const QString &csvFilePath, int nInput, int nOutput)
+    : sourceModified_(0)
+    , sourceSize_(0)
+    , nInput_(nInput)
+    , nOutput_(nOutput)
+{
+    QFileInfo info(csvFilePath);
+    sourcePath_ = info.canonicalFilePath();
+    if (sourcePath_.isEmpty())
+        return;
+    sourceModified_ = info.lastModified().toMSecsSinceEpoch();
+    sourceSize_ = info.size();
+
+    QCryptographicHash key(QCryptographicHash::Sha1);
+    key.addData(sourcePath_.toUtf8());
+    key.addData(QByteArray::number(nInput) + "," + QByteArray::number(nOutput));
+    const QString dir = QStandardPaths::writableLocation(QStandardPaths::CacheLocation)
+                        + QStringLiteral("/datasets");
+    cacheFilePath_ = dir + "/" + QString::fromLatin1(key.result().toHex()) + ".bin";
+}
+
+QString CSVCache::cacheFilePath() const
+{
+    return cacheFilePath_;
+}
+
+bool CSVCache::load(MatrixXd &trainingIn, MatrixXd &trainingOut,
+                    MatrixXd &testingIn, MatrixXd &testingOut) const
+{
+    if (cacheFilePath_.isEmpty())
+        return false;
+    QFile file(cacheFilePath_);
+    if (!file.open(QIODevice::ReadOnly))
+        return false;
+
+    // the file is mapped, so only the matrices are read from disk
+    const qint64 size = file.size();
+    const uchar *data = file.map(0, size);
+    if (!data)
+        return false;
+    const QByteArray bytes = QByteArray::fromRawData(reinterpret_cast<const char *>(data), size);
+    QDataStream in(bytes);
+    in.setVersion(QDataStream::Qt_5_0);
+    in.setByteOrder(QDataStream::LittleEndian);
+    CacheHeader h;
+    in >> h;
+
+    const bool hostLittleEndian = QSysInfo::ByteOrder == QSysInfo::LittleEndian;
+    const qint64 nColumn = h.nInput + h.nOutput;
+    if (in.status() != QDataStream::Ok || h.littleEndian != hostLittleEndian
+        || h.sourcePath != sourcePath_ || h.sourceModified != sourceModified_
+        || h.sourceSize != sourceSize_ || h.nInput != nInput_ || h.nOutput != nOutput_
+        || h.payloadOffset % CACHE_ALIGNMENT != 0
+        || h.payloadOffset + (qint64(h.nTraining) + h.nTest) * nColumn * qint64(sizeof(double)) > size) {
+        Log::info() << "Ignoring stale dataset cache " << cacheFilePath_;
+        return false;
+    }
+
+    const double *values = reinterpret_cast<const double *>(data + h.payloadOffset);
+    auto next = [&values](MatrixXd &m, int rows, int cols) {
+        m = Eigen::Map<const MatrixXd>(values, rows, cols);
+        values += qint64(rows) * cols;
+    };
+    next(trainingIn, h.nTraining, h.nInput);
+    next(trainingOut, h.nTraining, h.nOutput);
+    next(testingIn, h.nTest, h.nInput);
+    next(testingOut, h.nTest, h.nOutput);
+    return true;
+}
+
+bool CSVCache::store(const MatrixXd &trainingIn, const MatrixXd &trainingOut,
+                     const MatrixXd &testingIn, const MatrixXd &testingOut) const
+{
+    if (cacheFilePath_.isEmpty())
+        return false;
+    QDir().mkpath(QFileInfo(cacheFilePath_).path());
+
+    CacheHeader h;
+    h.sourcePath = sourcePath_;
+    h.sourceModified = sourceModified_;
+    h.sourceSize = sourceSize_;
+    h.nInput = nInput_;
+    h.nOutput = nOutput_;
+    h.nTraining = trainingIn.rows();
+    h.nTest = testingIn.rows();
+    // the header size does not depend on the value of payloadOffset
+    h.payloadOffset = (serialize(h).size() + CACHE_ALIGNMENT - 1)
+                      / CACHE_ALIGNMENT * CACHE_ALIGNMENT;
+    QByteArray header = serialize(h);
+    header.append(QByteArray(h.payloadOffset - header.size(), '\0'));
+
+    QSaveFile file(cacheFilePath_);
+    if (!file.open(QIODevice::WriteOnly)) {
+        Log::warning() << "Cannot write dataset cache " << cacheFilePath_;
+        return false;
+    }
+    file.write(header);
+    writeMatrix(file, trainingIn);
+    writeMatrix(file, trainingOut);
+    writeMatrix(file, testingIn);
+    writeMatrix(file, testingOut);
+    if (!file.commit()) {
+        Log::warning() << "Cannot write dataset cache " << cacheFilePath_;
+        return false;
+    }
+    return true;
+}
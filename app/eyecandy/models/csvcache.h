@@ -0,0 +1,46 @@
+#ifndef CSVCACHE_H
+#define CSVCACHE_H
+
+#include <Eigen/Core>
+#include <QString>
+
+/**
+ * Binary cache of the matrices UCWDataSet::generateCSV() creates.
+ *
+ * The cache file holds a header and the scaled training and testing
+ * matrices as contiguous column-major doubles, i.e. in the layout of
+ * Eigen::MatrixXd. It is keyed by the canonical path, modification time and
+ * size of the CSV file and by the split into input and output columns, so
+ * an edited CSV file or another layer configuration never hits a stale
+ * cache. Cache files live in the application cache directory.
+ */
+class CSVCache
+{
+public:
+    CSVCache(const QString &csvFilePath, int nInput, int nOutput);
+
+    /**
+     * Fill the matrices from the cache.
+     * @return false if there is no valid cache for the CSV file
+     */
+    bool load(Eigen::MatrixXd &trainingIn, Eigen::MatrixXd &trainingOut,
+              Eigen::MatrixXd &testingIn, Eigen::MatrixXd &testingOut) const;
+    /**
+     * Write the matrices to the cache, replaces an existing cache atomically.
+     * @return false if the cache could not be written
+     */
+    bool store(const Eigen::MatrixXd &trainingIn, const Eigen::MatrixXd &trainingOut,
+               const Eigen::MatrixXd &testingIn, const Eigen::MatrixXd &testingOut) const;
+
+    QString cacheFilePath() const;
+
+private:
+    QString sourcePath_;
+    qint64 sourceModified_;
+    qint64 sourceSize_;
+    int nInput_;
+    int nOutput_;
+    QString cacheFilePath_;
+};
+
+#endif // CSVCACHE_H
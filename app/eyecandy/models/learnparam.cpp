@@ -8,6 +8,8 @@ LearnParam::LearnParam(double learnRate, double kernelSize, double pValue)
     , dataSource_(DataSource::CSV)
     , csvFilePath_("/media/Documents/GradProject/data/VQdata.csv")
     , errorFunc_(Closs)
+    , optimizer_(LMA)
+    , batchSize_(32)
     , learningRate_(learnRate)
     , kernelSize_(kernelSize)
     , pValue_(pValue)
@@ -30,6 +32,28 @@ LearnParam &LearnParam::errorFunc(LearnParam::ErrorFunction func)
     return *this;
 }
 
+LearnParam::Optimizer LearnParam::optimizer() const
+{
+    return optimizer_;
+}
+
+LearnParam &LearnParam::optimizer(LearnParam::Optimizer opt)
+{
+    optimizer_ = opt;
+    return *this;
+}
+
+int LearnParam::batchSize() const
+{
+    return batchSize_;
+}
+
+LearnParam &LearnParam::batchSize(int size)
+{
+    batchSize_ = size;
+    return *this;
+}
+
 double LearnParam::learningRate() const
 {
     return learningRate_;
@@ -145,6 +169,10 @@ QString LearnParam::toDebugString(int indent, char indentChar) const
         out << ind << "CSV file path:" << csvFilePath() << "\n";
     }
     out << ind << "Error function:" << errorFunc() << "\n";
+    out << ind << "Optimizer:" << optimizer() << "\n";
+    if (optimizer() != LMA) {
+        out << ind << "Batch size:" << batchSize() << "\n";
+    }
     out << ind << "Learning rate:" << learningRate() << "\n";
     out << ind << "Kernel size:" << kernelSize() << "\n";
     out << ind << "P value:" << pValue() << "\n";
@@ -169,7 +197,7 @@ void LearnParam::debugPrint() const
     qDebug() << toDebugString(0);
 }
 
-Log::Logger operator <<(Log::Logger writter, const LearnParam &param)
+Log::Logger &operator <<(Log::Logger &writter, const LearnParam &param)
 {
     return writter << param.toDebugString(32, '`')
                       .replace("\n", "<br>")
@@ -43,11 +43,27 @@ public:
         Closs
     };
 
+    enum Optimizer {
+        LMA,
+        Momentum,
+        Nesterov,
+        Adam
+    };
+
     LearnParam(double learningRate = 0.01, double kernelSize = 0.5, double pValue = 2);
 
     ErrorFunction errorFunc() const;
     LearnParam& errorFunc(ErrorFunction func);
 
+    Optimizer optimizer() const;
+    LearnParam& optimizer(Optimizer opt);
+
+    /**
+     * Number of examples per mini-batch, ignored by LMA.
+     */
+    int batchSize() const;
+    LearnParam& batchSize(int size);
+
     double learningRate() const;
     LearnParam& learningRate(double value);
 
@@ -91,6 +107,8 @@ private:
     StoppingCriteria stoppingCriteria_;
 
     ErrorFunction errorFunc_;
+    Optimizer optimizer_;
+    int batchSize_;
     double learningRate_;
     double kernelSize_;
     double pValue_;
@@ -98,6 +116,6 @@ private:
     QList<LayerDesc> layers_;
 };
 
-Logger operator <<(Logger writter, const LearnParam &param);
+Logger &operator <<(Logger &writter, const LearnParam &param);
 
 #endif // LEARNPARAM_H
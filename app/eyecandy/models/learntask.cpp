@@ -15,36 +15,51 @@ LearnTask::LearnTask(const LearnParam &param)
     data_ = make_unique(createDataSourceFromParam(param));
 
     // Step 3. setup network
-    switch (param.errorFunc()) {
+    network_ = make_unique(createNetwork());
+    network_->initialize();
+}
+
+Net *LearnTask::createNetwork() const
+{
+    Net *network = nullptr;
+    ClossNet *clossNet = nullptr;
+    switch (param_.errorFunc()) {
     case LearnParam::MSE:
-        network_ = make_unique(new Net);
+        network = new Net;
         break;
     case LearnParam::Closs:
-        network_ = make_unique(new ClossNet);
+        network = clossNet = new ClossNet;
         // set parameters
-        clossNet().setKernelSize(param.kernelSize());
-        clossNet().setPValue(param.pValue());
+        clossNet->setKernelSize(param_.kernelSize());
+        clossNet->setPValue(param_.pValue());
         break;
     }
 
     // initialize MLP
-    for (auto layer : param.layers()) {
+    for (auto layer : param_.layers()) {
         switch (layer.type) {
         case LayerDesc::Input:
-            network_->inputLayer(data_->inputs());
+            network->inputLayer(data_->inputs());
             break;
         case LayerDesc::FullyConnected:
-            network_->fullyConnectedLayer(layer.nUnit, (ActivationFunction)layer.activationFunc);
+            // BPLayers let ClossNet compute the LMA Jacobian in one batch
+            if (clossNet)
+                clossNet->bpLayer(layer.nUnit, (ActivationFunction)layer.activationFunc);
+            else
+                network->fullyConnectedLayer(layer.nUnit, (ActivationFunction)layer.activationFunc);
             break;
         case LayerDesc::Output:
-            network_->outputLayer(data_->outputs(), (ActivationFunction)layer.activationFunc);
+            if (clossNet)
+                clossNet->bpLayer(data_->outputs(), (ActivationFunction)layer.activationFunc);
+            else
+                network->outputLayer(data_->outputs(), (ActivationFunction)layer.activationFunc);
             break;
         default:
             break;
         }
     }
-    network_->trainingSet(*data_);
-    network_->initialize();
+    network->trainingSet(data_->training());
+    return network;
 }
 
 UCWDataSet *LearnTask::createDataSourceFromParam(const LearnParam &param)
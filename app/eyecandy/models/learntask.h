@@ -26,6 +26,13 @@ public:
 
     const LearnParam &parameters() const;
 
+    /**
+     * Creates a network with the architecture of network() that uses the
+     * training set of data(). The caller owns the network and has to
+     * initialize it.
+     */
+    Net *createNetwork() const;
+
 protected:
     UCWDataSet *createDataSourceFromParam(const LearnParam &param);
 
@@ -0,0 +1,97 @@
+#include "plotdata.h"
+#include "PredictionPlane.h"
+#include <cstring>
+
+PlotData::PlotData()
+    : PlotData(Scatter, 0, 0.0f, 0.0f, 0)
+{
+}
+
+PlotData::PlotData(Kind kind, int count, float min, float max, int size)
+    : bytes_(sizeof(Header) + size * sizeof(float), Qt::Uninitialized)
+{
+    Header header = { quint32(kind), quint32(count), min, max };
+    std::memcpy(bytes_.data(), &header, sizeof(Header));
+}
+
+PlotData PlotData::scatter(const Eigen::MatrixXd &input, const Eigen::MatrixXd &output)
+{
+    const int n = input.rows();
+    PlotData result(Scatter, n, 0.0f, 0.0f, 3 * n);
+    float *point = result.data();
+    for (int i = 0; i != n; i++, point += 3) {
+        point[0] = input(i, 0);
+        point[1] = output(i, 0);
+        point[2] = input.cols() > 1 ? input(i, 1) : 0.0f;
+    }
+    return result;
+}
+
+PlotData PlotData::plane(const PredictionPlane &plane)
+{
+    const int n = plane.resolution();
+    PlotData result(Plane, n, plane.minimum(), plane.maximum(), n * n);
+    std::memcpy(result.data(), plane.values().data(), n * n * sizeof(float));
+    return result;
+}
+
+PlotData::Kind PlotData::kind() const
+{
+    return Kind(header().kind);
+}
+
+int PlotData::count() const
+{
+    return header().count;
+}
+
+float PlotData::minimum() const
+{
+    return header().min;
+}
+
+float PlotData::maximum() const
+{
+    return header().max;
+}
+
+const float *PlotData::values() const
+{
+    return reinterpret_cast<const float *>(bytes_.constData() + sizeof(Header));
+}
+
+int PlotData::size() const
+{
+    return (bytes_.size() - sizeof(Header)) / sizeof(float);
+}
+
+QByteArray PlotData::bytes() const
+{
+    return bytes_;
+}
+
+QString PlotData::toBase64() const
+{
+    return QString::fromLatin1(bytes_.toBase64());
+}
+
+void PlotData::registerMetaType()
+{
+    static bool registered = false;
+    if (registered) return;
+    registered = true;
+
+    qRegisterMetaType<PlotData>("PlotData");
+    QMetaType::registerConverter<PlotData, QString>(&PlotData::toBase64);
+}
+
+const PlotData::Header &PlotData::header() const
+{
+    // the data of a QByteArray is at least 8 byte aligned
+    return *reinterpret_cast<const Header *>(bytes_.constData());
+}
+
+float *PlotData::data()
+{
+    return reinterpret_cast<float *>(bytes_.data() + sizeof(Header));
+}
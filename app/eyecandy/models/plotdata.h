@@ -0,0 +1,85 @@
+#ifndef PLOTDATA_H
+#define PLOTDATA_H
+
+#include <Eigen/Core>
+#include <QByteArray>
+#include <QMetaType>
+#include <QString>
+
+class PredictionPlane;
+
+/**
+ * Points for the plots packed in one shared buffer.
+ *
+ * The buffer is a QByteArray with a 16 byte header followed by floats in
+ * native byte order. Copies share the buffer, so the data is never copied
+ * when it is emitted to another thread. There are two kinds:
+ *
+ * - Scatter: count() points of three values x, label, y, where x and y
+ *   are the two inputs and label is the first output.
+ * - Plane: count() * count() outputs on a grid from minimum() to
+ *   maximum(), row by row, see PredictionPlane.
+ *
+ * The web chart receives the buffer as a base64 string, see
+ * registerMetaType().
+ */
+class PlotData
+{
+public:
+    enum Kind {
+        Scatter,
+        Plane
+    };
+
+    /**
+     * Creates an empty scatter.
+     */
+    PlotData();
+
+    static PlotData scatter(const Eigen::MatrixXd &input, const Eigen::MatrixXd &output);
+    static PlotData plane(const PredictionPlane &plane);
+
+    Kind kind() const;
+    /**
+     * @return number of points of a scatter, resolution of a plane
+     */
+    int count() const;
+    float minimum() const;
+    float maximum() const;
+    /**
+     * @return 3 * count() values of a scatter, count() * count() of a plane
+     */
+    const float *values() const;
+    int size() const;
+
+    /**
+     * @return header and values
+     */
+    QByteArray bytes() const;
+    QString toBase64() const;
+
+    /**
+     * Register the type for queued connections and its conversion to
+     * QString, which QWebChannel uses to pass it to JavaScript.
+     */
+    static void registerMetaType();
+
+private:
+    struct Header
+    {
+        quint32 kind;
+        quint32 count;
+        float min;
+        float max;
+    };
+
+    PlotData(Kind kind, int count, float min, float max, int size);
+    const Header &header() const;
+    float *data();
+
+    QByteArray bytes_;
+};
+
+Q_DECLARE_METATYPE(PlotData)
+
+#endif // PLOTDATA_H
@@ -1,29 +1,91 @@
 #include "ucwdataset.h"
+#include "csvcache.h"
+#include "CsvLoader.h"
 #include "utils/utils.h"
 #include "utils/logger.h"
-#include "utils/dyncsvreader.h"
 #include <OpenANN/Learner.h>
 #include <OpenANN/Preprocessing.h>
 #include <OpenANN/util/AssertionMacros.h>
-#include <OpenANN/io/DirectStorageDataSet.h>
+#include <OpenANN/util/OpenANNException.h>
 #include <QVariantMap>
 #include <QDebug>
 #include <QFile>
 
 using Eigen::MatrixXd;
 using Eigen::VectorXd;
-using CSV::DynCsvReader;
-using ContextManager = UCWDataSet::ContextManager;
+using View = UCWDataSet::View;
+
+View::View()
+    : input_()
+    , output_()
+{
+}
+
+View::View(MatrixXd input, MatrixXd output)
+    : input_(std::move(input))
+    , output_(std::move(output))
+{
+    OPENANN_CHECK_EQUALS(input_.rows(), output_.rows());
+}
+
+int View::samples()
+{
+    return input_.rows();
+}
+
+int View::inputs()
+{
+    return input_.cols();
+}
+
+int View::outputs()
+{
+    return output_.cols();
+}
+
+Eigen::VectorXd& View::getInstance(int i)
+{
+    // thread local, so readers of the same view do not overwrite each other
+    static thread_local VectorXd instance;
+    instance = input_.row(i).transpose();
+    return instance;
+}
+
+Eigen::VectorXd& View::getTarget(int i)
+{
+    static thread_local VectorXd target;
+    target = output_.row(i).transpose();
+    return target;
+}
+
+void View::finishIteration(Learner& learner)
+{
+}
+
+MatrixXd& View::inputMatrix()
+{
+    return input_;
+}
+
+MatrixXd& View::outputMatrix()
+{
+    return output_;
+}
+
+const MatrixXd &View::input() const
+{
+    return input_;
+}
+
+const MatrixXd &View::output() const
+{
+    return output_;
+}
 
 UCWDataSet::UCWDataSet(DataSource source)
-    : DataSet()
-    , inTrainingMode_(true)
-    , trainingIn()
-    , trainingOut()
-    , testingIn()
-    , testingOut()
-    , trainingData(nullptr)
-    , testingData(nullptr)
+    : training_()
+    , testing_()
+    , validation_()
     , inputRange_()
     , outputRange_()
     , outputLabelCount_(2)
@@ -38,48 +100,33 @@ UCWDataSet::UCWDataSet(DataSource source)
     }
 }
 
-void UCWDataSet::createInternalDataSet()
-{
-    trainingData = make_unique(new DirectStorageDataSet(&trainingIn, &trainingOut));
-    testingData = make_unique(new DirectStorageDataSet(&testingIn, &testingOut));
-}
-
 UCWDataSet::~UCWDataSet()
 {
 }
 
-DirectStorageDataSet &UCWDataSet::dataSet()
+View &UCWDataSet::training()
 {
-    return inTrainingMode() ? *trainingData : *testingData;
+    return training_;
 }
 
-int UCWDataSet::samples()
+View &UCWDataSet::testing()
 {
-    return dataSet().samples();
+    return testing_;
 }
 
-int UCWDataSet::inputs()
+View &UCWDataSet::validation()
 {
-    return dataSet().inputs();
+    return validation_;
 }
 
-int UCWDataSet::outputs()
+int UCWDataSet::inputs() const
 {
-    return dataSet().outputs();
+    return training_.input().cols();
 }
 
-Eigen::VectorXd& UCWDataSet::getInstance(int i)
-{
-    return dataSet().getInstance(i);
-}
-
-Eigen::VectorXd& UCWDataSet::getTarget(int i)
-{
-    return dataSet().getTarget(i);
-}
-
-void UCWDataSet::finishIteration(Learner& learner)
+int UCWDataSet::outputs() const
 {
+    return training_.output().cols();
 }
 
 range UCWDataSet::inputRange() const
@@ -97,29 +144,29 @@ int UCWDataSet::outputLabelCount() const
     return outputLabelCount_;
 }
 
-bool UCWDataSet::inTrainingMode() const
+void UCWDataSet::splitValidation(double fraction)
 {
-    return inTrainingMode_;
-}
-
-void UCWDataSet::inTrainingMode(bool val)
-{
-    inTrainingMode_ = val;
+    const MatrixXd &in = training_.input();
+    const MatrixXd &out = training_.output();
+    const int n = in.rows();
+    const int nValidation = qBound(0, int(n * fraction), n);
+    const int nTraining = n - nValidation;
+
+    validation_ = View(in.bottomRows(nValidation), out.bottomRows(nValidation));
+    training_ = View(in.topRows(nTraining), out.topRows(nTraining));
 }
 
 bool UCWDataSet::generateNone()
 {
     Log::warning() << "Generating empty data set!";
 
-    trainingIn.resize(0, 2);
-    trainingOut.resize(0, 1);
-    testingIn.resize(0, 2);
-    testingOut.resize(0, 1);
+    training_ = View(MatrixXd(0, 2), MatrixXd(0, 1));
+    testing_ = View(MatrixXd(0, 2), MatrixXd(0, 1));
+    validation_ = View(MatrixXd(0, 2), MatrixXd(0, 1));
     inputRange_ = {0.0, 0.0};
     outputRange_ = {0.0, 0.0};
     outputLabelCount_ = 0;
 
-    createInternalDataSet();
     return true;
 }
 
@@ -128,10 +175,10 @@ bool UCWDataSet::generateTwoSpirals(int density, double maxDiameter)
     // Number of interior data points per spiral to generate
     const int points = 96 * density;
 
-    trainingIn.resize(points + 1, 2);
-    trainingOut.resize(points + 1, 1);
-    testingIn.resize(points + 1, 2);
-    testingOut.resize(points + 1, 1);
+    MatrixXd trainingIn(points + 1, 2);
+    MatrixXd trainingOut(points + 1, 1);
+    MatrixXd testingIn(points + 1, 2);
+    MatrixXd testingOut(points + 1, 1);
     int trIdx = 0;
     int teIdx = 0;
 
@@ -179,71 +226,49 @@ bool UCWDataSet::generateTwoSpirals(int density, double maxDiameter)
     outputRange_ = {-1.0, 1.0};
     outputLabelCount_ = 2;
 
-    createInternalDataSet();
+    training_ = View(std::move(trainingIn), std::move(trainingOut));
+    testing_ = View(std::move(testingIn), std::move(testingOut));
+    validation_ = View(MatrixXd(0, 2), MatrixXd(0, 1));
     return true;
 }
 
 bool UCWDataSet::generateCSV(QString filePath, int nInput, int nOutput)
 {
-    const int MAX_COLUMN = 20;
-    if (nInput + nOutput > MAX_COLUMN) {
-        Log::critical() << "generateCSV: nInput(" << nInput << ")"
-                        << "+ nOutput(" << nOutput << ") "
-                        << "larger than MAX_COLUMN("<< MAX_COLUMN << ")!";
-        return generateNone();
+    // parsing is paid only once per CSV file and column split
+    CSVCache cache(filePath, nInput, nOutput);
+    MatrixXd trainingIn, trainingOut, testingIn, testingOut;
+    if (cache.load(trainingIn, trainingOut, testingIn, testingOut)) {
+        Log::info() << "Loaded " << filePath << " from cache " << cache.cacheFilePath();
+        inputRange_ = {-1.5, 1.5};
+        outputRange_ = {-1.0, 1.0};
+        outputLabelCount_ = 2 * nOutput;
+        training_ = View(std::move(trainingIn), std::move(trainingOut));
+        testing_ = View(std::move(testingIn), std::move(testingOut));
+        validation_ = View(MatrixXd(0, nInput), MatrixXd(0, nOutput));
+        return true;
     }
-    struct row{
-        double c[MAX_COLUMN];
-    };
-    QList<row> data;
 
+    int nTraining = 0;
+    int nTest = 0;
     try
     {
-        auto reader = DynCsvReader::createReader(nInput+nOutput, filePath.toLocal8Bit().data());
-
-        // read in each line
-        row r;
-        while (reader->readRow(r.c))
-        {
-            data << r;
-        }
+        CsvLoader loader;
+        const int nRow = loader.open(filePath.toLocal8Bit().data());
+        nTest = nRow / 2;
+        nTraining = nRow - nTest;
+        trainingIn.resize(nTraining, nInput);
+        trainingOut.resize(nTraining, nOutput);
+        testingIn.resize(nTest, nInput);
+        testingOut.resize(nTest, nOutput);
+        loader.read(0, nTraining, trainingIn, trainingOut);
+        loader.read(nTraining, nRow, testingIn, testingOut);
     }
-    catch (CSV::Exceptions::FileNotFound)
+    catch (const OpenANN::OpenANNException &e)
     {
-        Log::critical() << "CSV file not found: " << filePath;
+        Log::critical() << "Cannot read CSV file " << filePath << ": " << e.what();
         return generateNone();
     }
 
-    int nTest = data.size() / 2;
-//    int nTest = 5000;
-    int nTraining = data.size() - nTest;
-    trainingIn.resize(nTraining, nInput);
-    trainingOut.resize(nTraining, nOutput);
-    testingIn.resize(nTest, nInput);
-    testingOut.resize(nTest, nOutput);
-
-    int rowIdx;
-    int rowTraining = 0;
-    int rowTesting = 0;
-    for (rowIdx = 0; rowIdx!= nTraining; rowIdx++)
-    {
-        int c;
-        for (c = 0; c!= nInput; c++)
-            trainingIn(rowTraining, c) = data.at(rowIdx).c[c];
-        for (; c!= nInput + nOutput; c++)
-            trainingOut(rowTraining, c - nInput) = data.at(rowIdx).c[c];
-        rowTraining++;
-    }
-    for (; rowIdx!= nTest + nTraining; rowIdx++)
-    {
-        int c;
-        for (c = 0; c!= nInput; c++)
-            testingIn(rowTesting, c) = data.at(rowIdx).c[c];
-        for (; c!= nInput + nOutput; c++)
-            testingOut(rowTesting, c - nInput) = data.at(rowIdx).c[c];
-        rowTesting++;
-    }
-
     if (nTraining)
         OpenANN::scaleData(trainingIn, -1.5, 1.5);
     if (nTest)
@@ -252,56 +277,11 @@ bool UCWDataSet::generateCSV(QString filePath, int nInput, int nOutput)
     outputRange_ = {-1.0, 1.0};
     outputLabelCount_ = 2 * nOutput;
 
-    createInternalDataSet();
+    cache.store(trainingIn, trainingOut, testingIn, testingOut);
+    training_ = View(std::move(trainingIn), std::move(trainingOut));
+    testing_ = View(std::move(testingIn), std::move(testingOut));
+    validation_ = View(MatrixXd(0, nInput), MatrixXd(0, nOutput));
     qDebug() << "nTraining is " << nTraining;
     qDebug() << "nTesting is " << nTest;
     return true;
 }
-
-ContextManager::ContextManager(UCWDataSet *dataset, bool inTrainingMode, bool multiThreadSafe)
-    : dataset_(dataset)
-    , oldMode_(dataset->inTrainingMode())
-    , multiThreadSafe_(multiThreadSafe)
-    , empty_(false)
-{
-    maybeLock();
-    dataset->inTrainingMode(inTrainingMode);
-}
-
-ContextManager::ContextManager(ContextManager &&other)
-    : dataset_(other.dataset_)
-    , oldMode_(other.oldMode_)
-    , empty_(false)
-{
-    other.empty_ = true;
-}
-
-void ContextManager::maybeLock()
-{
-    if (multiThreadSafe_)
-        dataset_->modeLock_.lock();
-}
-
-void ContextManager::maybeUnlock()
-{
-    if (multiThreadSafe_)
-        dataset_->modeLock_.unlock();
-}
-
-ContextManager::~ContextManager()
-{
-    if (!empty_) {
-        dataset_->inTrainingMode(oldMode_);
-        maybeUnlock();
-    }
-}
-
-ContextManager UCWDataSet::enterTrainingMode(bool multiThreadSafe)
-{
-    return ContextManager(this, true, multiThreadSafe);
-}
-
-ContextManager UCWDataSet::enterTestingMode(bool multiThreadSafe)
-{
-    return ContextManager(this, false, multiThreadSafe);
-}
@@ -3,42 +3,59 @@
 
 #include <Eigen/Core>
 #include <OpenANN/io/DataSet.h>
+#include "MatrixDataSet.h"
 #include <QObject>
-#include <QMutex>
 #include <QVariantList>
 #include <memory>
 #include <utility>
 
-namespace OpenANN {
-class DirectStorageDataSet;
-}
 using Eigen::MatrixXd;
 using OpenANN::DataSet;
-using OpenANN::DirectStorageDataSet;
 using OpenANN::Learner;
 using std::unique_ptr;
 using std::pair;
 using range = pair<double, double>;
 
-class UCWDataSet : public QObject, public DataSet
+class UCWDataSet : public QObject
 {
     Q_OBJECT
 public:
-    class ContextManager
+    /**
+     * Training, testing or validation part of the data set.
+     *
+     * A view owns its matrices and never changes them after construction,
+     * so any number of threads can read it at the same time. The vectors
+     * returned by getInstance() and getTarget() are per thread.
+     */
+    class View : public MatrixDataSet
     {
-        UCWDataSet *dataset_;
-        bool oldMode_;
-        bool multiThreadSafe_;
-        bool empty_;
-
-        ContextManager(UCWDataSet *dataset_, bool inTrainingMode, bool multiThreadSafe = true);
-        void maybeLock();
-        void maybeUnlock();
-
-        friend class UCWDataSet;
     public:
-        ContextManager(ContextManager &&other);
-        ~ContextManager();
+        View();
+        View(MatrixXd input, MatrixXd output);
+
+        virtual int samples();
+        virtual int inputs();
+        virtual int outputs();
+        /**
+         * The returned vector is shared by all views of the calling thread,
+         * it is only valid until the next call of getInstance() on any view
+         * in that thread. Copy it to keep it longer.
+         */
+        virtual Eigen::VectorXd& getInstance(int i);
+        /**
+         * Same lifetime as getInstance(), with a separate vector.
+         */
+        virtual Eigen::VectorXd& getTarget(int i);
+        virtual void finishIteration(Learner& learner);
+        virtual MatrixXd& inputMatrix();
+        virtual MatrixXd& outputMatrix();
+
+        const MatrixXd &input() const;
+        const MatrixXd &output() const;
+
+    private:
+        MatrixXd input_;
+        MatrixXd output_;
     };
 
     enum DataSource {
@@ -50,26 +67,32 @@ public:
     UCWDataSet(DataSource source = TwoSpirals);
     virtual ~UCWDataSet();
 
-    virtual int samples();
-    virtual int inputs();
-    virtual int outputs();
-    virtual Eigen::VectorXd& getInstance(int i);
-    virtual Eigen::VectorXd& getTarget(int i);
-    virtual void finishIteration(Learner& learner);
+    View &training();
+    View &testing();
+    /**
+     * Empty unless splitValidation() was called.
+     */
+    View &validation();
 
-    void inTrainingMode(bool val);
-    bool inTrainingMode() const;
-    ContextManager enterTrainingMode(bool multiThreadSafe = true);
-    ContextManager enterTestingMode(bool multiThreadSafe = true);
+    int inputs() const;
+    int outputs() const;
 
     range inputRange() const;
     range outputRange() const;
     int outputLabelCount() const;
 
     /**
-     * Creates dataset csv file.
-     * with following constrain:
-     * nInput + nOutput <= 10
+     * Moves the last rows of the training set to the validation set.
+     * Must be called before the views are handed to other threads.
+     *
+     * @param fraction part of the training rows to move, between 0 and 1
+     */
+    void splitValidation(double fraction);
+
+    /**
+     * Creates dataset from csv file.
+     * The first half of the rows is used for training, the first nInput
+     * columns are inputs and the next nOutput columns are outputs.
      *
      * @param filePath path to the csv file
      * @param nInput number of input units
@@ -93,22 +116,12 @@ public:
 
 signals:
 
-protected:
-    DirectStorageDataSet &dataSet();
-    void createInternalDataSet();
-    void dispose();
-
 private:
-    bool inTrainingMode_;
-    MatrixXd trainingIn;
-    MatrixXd trainingOut;
-    MatrixXd testingIn;
-    MatrixXd testingOut;
-    unique_ptr<DirectStorageDataSet> trainingData;
-    unique_ptr<DirectStorageDataSet> testingData;
+    View training_;
+    View testing_;
+    View validation_;
     range inputRange_;
     range outputRange_;
     int outputLabelCount_;
-    QMutex modeLock_;
 };
 #endif // DATASET_H_
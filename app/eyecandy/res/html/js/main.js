@@ -180,19 +180,62 @@ function actualWork() {
     bridge.handler.testingDataUpdated.connect(setTestingData);
 }
 
+// PlotData arrives as base64 string, see models/plotdata.h
+function decodePlotData(base64) {
+    var binary = atob(base64 || "");
+    var bytes = new Uint8Array(Math.max(binary.length, 16));
+    for (var i = 0; i < binary.length; i++) {
+        bytes[i] = binary.charCodeAt(i);
+    }
+    var header = new Uint32Array(bytes.buffer, 0, 2);
+    var range = new Float32Array(bytes.buffer, 8, 2);
+    return {
+        kind: header[0],
+        count: header[1],
+        min: range[0],
+        max: range[1],
+        values: new Float32Array(bytes.buffer, 16)
+    };
+}
+
+// points [x, z, y] of a scatter
+function scatterPoints(data) {
+    var points = new Array(data.count);
+    for (var i = 0; i < data.count; i++) {
+        points[i] = [data.values[3 * i], data.values[3 * i + 1], data.values[3 * i + 2]];
+    }
+    return points;
+}
+
+// points [x, z, y] of a plane
+function planePoints(data) {
+    var n = data.count;
+    var step = n > 1 ? (data.max - data.min) / (n - 1) : 0;
+    var points = new Array(n * n);
+    for (var y = 0; y < n; y++) {
+        for (var x = 0; x < n; x++) {
+            points[y * n + x] = [data.min + step * x, data.values[y * n + x], data.min + step * y];
+        }
+    }
+    return points;
+}
+
 function setPrediction(data) {
-    log("Setting prediction plain with length", data.length);
-    theChart.series[2].setData(data);
+    var points = planePoints(decodePlotData(data));
+    log("Setting prediction plain with length", points.length);
+    theChart.series[2].setData(points);
 }
 
 function setTrainingData(data) {
-    log("Setting training data with length", data.length);
-    theChart.series[0].setData(data);
+    var points = scatterPoints(decodePlotData(data));
+    log("Setting training data with length", points.length);
+    theChart.series[0].setData(points);
 }
 
 function setTestingData(data) {
-    log("Setting testing data with length", data.length);
-    theChart.series[1].setData(data);
+    var points = scatterPoints(decodePlotData(data));
+    log("Setting testing data with length", points.length);
+    theChart.series[1].setData(points);
 }
 
 // Mouse event handling is broken in QtQuick WebView
@@ -1,7 +1,10 @@
 #include "utils/logger.h"
 
+#include <QCoreApplication>
 #include <QDateTime>
 #include <QDebug>
+#include <QMetaObject>
+#include <QTimer>
 
 namespace Log
 {
@@ -15,6 +18,7 @@ public:
     LoggerStaticInitializer()
     {
         qRegisterMetaType<Msg>("Msg");
+        qRegisterMetaType<QVector<Msg>>("QVector<Msg>");
         instance = new LogStorage;
     }
 };
@@ -28,10 +32,79 @@ Msg::Msg(int id, MsgType type, const QString &message)
     , message(message)
 { }
 
+MessageQueue::MessageQueue()
+    : head_(0)
+    , tail_(0)
+    , dropped_(0)
+{
+    static_assert((LOG_QUEUE_CAPACITY & (LOG_QUEUE_CAPACITY - 1)) == 0,
+                  "LOG_QUEUE_CAPACITY must be a power of two");
+    for (int i = 0; i < LOG_QUEUE_CAPACITY; i++)
+        slots_[i].sequence.store(i, std::memory_order_relaxed);
+}
+
+bool MessageQueue::push(MsgType type, const QString &message)
+{
+    quint64 pos = head_.load(std::memory_order_relaxed);
+    Slot *slot;
+    forever {
+        slot = &slots_[pos & (LOG_QUEUE_CAPACITY - 1)];
+        quint64 seq = slot->sequence.load(std::memory_order_acquire);
+        qint64 diff = qint64(seq) - qint64(pos);
+        if (diff == 0) {
+            if (head_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                break;
+        } else if (diff < 0) {
+            // the reader has not consumed this slot yet
+            dropped_.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        } else {
+            pos = head_.load(std::memory_order_relaxed);
+        }
+    }
+
+    slot->type = type;
+    slot->timestamp = QDateTime::currentMSecsSinceEpoch();
+    slot->message = message;
+    slot->sequence.store(pos + 1, std::memory_order_release);
+    return true;
+}
+
+bool MessageQueue::pop(Msg &msg)
+{
+    Slot &slot = slots_[tail_ & (LOG_QUEUE_CAPACITY - 1)];
+    if (slot.sequence.load(std::memory_order_acquire) != tail_ + 1)
+        return false;
+
+    msg.type = slot.type;
+    msg.timestamp = slot.timestamp;
+    msg.message.swap(slot.message);
+    // release the old string here and not in a writer
+    slot.message.clear();
+    slot.sequence.store(tail_ + LOG_QUEUE_CAPACITY, std::memory_order_release);
+    tail_++;
+    return true;
+}
+
+int MessageQueue::takeDropped()
+{
+    return dropped_.exchange(0, std::memory_order_relaxed);
+}
+
 LogStorage::LogStorage()
-    : lock(QReadWriteLock::Recursive)
+    : m_messages(MAX_LOG_MESSAGES)
+    , lock(QReadWriteLock::Recursive)
     , msgCounter(0)
+    , timer(new QTimer(this))
 {
+    // the instance may be created by any thread, deliver in the GUI thread
+    if (QCoreApplication::instance())
+        moveToThread(QCoreApplication::instance()->thread());
+
+    timer->setInterval(LOG_DELIVERY_INTERVAL);
+    connect(timer, &QTimer::timeout, this, &LogStorage::deliver);
+    // timers can only be started from their own thread
+    QMetaObject::invokeMethod(timer, "start", Qt::QueuedConnection);
 }
 
 LogStorage *LogStorage::instance()
@@ -41,39 +114,49 @@ LogStorage *LogStorage::instance()
 
 void LogStorage::addMessage(const QString &message, const MsgType &type)
 {
-    QWriteLocker locker(&lock);
+    queue.push(type, message);
+}
+
+void LogStorage::deliver()
+{
+    QVector<Msg> batch;
+    Msg msg;
+    while (queue.pop(msg))
+        batch.append(msg);
+
+    int dropped = queue.takeDropped();
+    if (dropped > 0)
+        batch.append(Msg(0, WARNING, tr("%1 log messages were dropped").arg(dropped)));
 
-    Msg temp(msgCounter++, type, message);
-    m_messages.push_back(temp);
+    if (batch.isEmpty())
+        return;
 
-    if (m_messages.size() >= MAX_LOG_MESSAGES)
-        m_messages.pop_front();
+    {
+        QWriteLocker locker(&lock);
+        for (Msg &m : batch) {
+            m.id = msgCounter++;
+            m_messages.append(m);
+        }
+    }
 
-    emit newLogMessage(temp);
+    emit newLogMessages(batch);
 }
 
 QVector<Msg> LogStorage::getMessages(int lastKnownId) const
 {
     QReadLocker locker(&lock);
 
-    int diff = msgCounter - lastKnownId - 1;
-    int size = m_messages.size();
-
-    if ((lastKnownId == -1) || (diff >= size))
-        return m_messages;
-
-    if (diff <= 0)
-        return QVector<Msg>();
-
-    return m_messages.mid(size - diff);
+    QVector<Msg> result;
+    int first = qMax(lastKnownId + 1, m_messages.firstIndex());
+    for (int i = first; i <= m_messages.lastIndex(); i++)
+        result.append(m_messages.at(i));
+    return result;
 }
 
 Logger::~Logger()
 {
-    if (!--stream->ref) {
-        stream->store->addMessage(stream->buffer, stream->type);
-        delete stream;
-    }
+    if (store)
+        store->addMessage(buffer, type);
 }
 
 } // namespace Log
@@ -3,11 +3,19 @@
 
 #include <QString>
 #include <QVector>
+#include <QContiguousCache>
 #include <QReadWriteLock>
 #include <QObject>
 #include <QTextStream>
+#include <atomic>
 
 const int MAX_LOG_MESSAGES = 1000;
+// messages that can wait for delivery, must be a power of two
+const int LOG_QUEUE_CAPACITY = 1024;
+// milliseconds between two deliveries to the UI
+const int LOG_DELIVERY_INTERVAL = 100;
+
+class QTimer;
 
 namespace Log
 {
@@ -28,6 +36,48 @@ struct Msg
     QString message;
 };
 
+/**
+ * Bounded queue of log messages from any number of threads to one reader.
+ *
+ * A writer claims a slot with a compare-and-swap of the write position and
+ * publishes it with the sequence number of the slot, so writing never takes
+ * a lock and never waits for the reader. Slots are allocated once. If the
+ * queue is full the message is dropped and counted.
+ */
+class MessageQueue
+{
+public:
+    MessageQueue();
+
+    /**
+     * @return false if the queue is full
+     */
+    bool push(MsgType type, const QString &message);
+    /**
+     * Must only be called by the reader.
+     * @return false if the queue is empty
+     */
+    bool pop(Msg &msg);
+    /**
+     * @return number of dropped messages since the last call
+     */
+    int takeDropped();
+
+private:
+    struct Slot
+    {
+        std::atomic<quint64> sequence;
+        MsgType type;
+        qint64 timestamp;
+        QString message;
+    };
+
+    Slot slots_[LOG_QUEUE_CAPACITY];
+    std::atomic<quint64> head_;
+    quint64 tail_;
+    std::atomic<int> dropped_;
+};
+
 class LoggerStaticInitializer;
 class LogStorage : public QObject
 {
@@ -39,42 +89,52 @@ public:
 
     static LogStorage* instance();
 
+    /**
+     * Queue a message, it is delivered to the UI with the next batch.
+     * Can be called from any thread and never blocks.
+     */
     void addMessage(const QString &message, const MsgType &type = NORMAL);
 
     QVector<Msg> getMessages(int lastKnownId = -1) const;
 
 signals:
-    void newLogMessage(const Msg &message);
+    /**
+     * Messages queued since the last delivery, oldest first.
+     */
+    void newLogMessages(const QVector<Msg> &messages);
+
+private slots:
+    void deliver();
 
 private:
     LogStorage();
 
-    QVector<Msg> m_messages;
+    MessageQueue queue;
+    QContiguousCache<Msg> m_messages;
     mutable QReadWriteLock lock;
     int msgCounter;
+    QTimer *timer;
 };
 
 class Logger {
+    LogStorage *store;
+    MsgType type;
+    QString buffer;
 
-    struct Stream {
-        Stream (LogStorage *s, MsgType t)
-            : store(s), type(t), ts(&buffer, QIODevice::WriteOnly), ref(1) {}
-
-        LogStorage *store;
-        MsgType type;
-        QString buffer;
-        QTextStream ts;
-        int ref;
-    } *stream;
+    Q_DISABLE_COPY(Logger)
 
 public:
-    inline Logger(LogStorage *storage, MsgType type) : stream(new Stream(storage, type)) {}
-    inline Logger(const Logger &o) : stream(o.stream) { ++stream->ref; }
+    inline Logger(LogStorage *storage, MsgType type) : store(storage), type(type) {}
+    inline Logger(Logger &&o) : store(o.store), type(o.type), buffer(std::move(o.buffer)) { o.store = nullptr; }
     ~Logger();
 
     template<typename T>
-    inline Logger operator<<(T value) { stream->ts << value; return *this; }
-    inline Logger operator<<(const char* t) { stream->ts << QString::fromLocal8Bit(t); return *this; }
+    inline Logger &operator<<(const T &value) { QTextStream(&buffer) << value; return *this; }
+    inline Logger &operator<<(const char* t) { buffer += QString::fromLocal8Bit(t); return *this; }
+    inline Logger &operator<<(const QString &s) { buffer += s; return *this; }
+    inline Logger &operator<<(int n) { buffer += QString::number(n); return *this; }
+    inline Logger &operator<<(qint64 n) { buffer += QString::number(n); return *this; }
+    inline Logger &operator<<(double n) { buffer += QString::number(n); return *this; }
 };
 
 inline Logger info() { return Logger(LogStorage::instance(), INFO); }
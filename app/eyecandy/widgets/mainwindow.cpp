@@ -95,6 +95,24 @@ void MainWindow::setupOptionPage()
     });
     ui->comboErrorFunc->addItem("Closs", LearnParam::Closs);
     ui->comboErrorFunc->addItem("MSE", LearnParam::MSE);
+    connect(ui->comboOptimizer, Select<int>::OverloadOf(&QComboBox::currentIndexChanged),
+    this, [=]() {
+        auto opt = LearnParam::Optimizer(ui->comboOptimizer->currentData().toInt());
+        currentParam.optimizer(opt);
+
+        // LMA has neither learning rate nor mini-batches
+        auto enableSGD = (opt != LearnParam::LMA);
+        ui->spinLearnRate->setEnabled(enableSGD);
+        ui->spinBatchSize->setEnabled(enableSGD);
+    });
+    ui->comboOptimizer->addItem("LMA", LearnParam::LMA);
+    ui->comboOptimizer->addItem("Momentum", LearnParam::Momentum);
+    ui->comboOptimizer->addItem("Nesterov", LearnParam::Nesterov);
+    ui->comboOptimizer->addItem("Adam", LearnParam::Adam);
+    connect(ui->spinBatchSize, Select<int>::OverloadOf(&QSpinBox::valueChanged),
+    this, [=](auto value) {
+        currentParam.batchSize(value);
+    });
 
     // Group Closs
     connect(ui->spinKernelSize, Select<double>::OverloadOf(&QDoubleSpinBox::valueChanged),
@@ -190,7 +208,12 @@ void MainWindow::setupLogPage()
     for (auto msg : store->getMessages()) {
         addLogMessage(msg);
     }
-    connect(store, &Log::LogStorage::newLogMessage, this, addLogMessage);
+    connect(store, &Log::LogStorage::newLogMessages,
+            this, [addLogMessage](const QVector<Log::Msg> &messages) {
+        for (auto &msg : messages) {
+            addLogMessage(msg);
+        }
+    });
 }
 
 void MainWindow::setupMonitorPage()
@@ -218,6 +241,9 @@ void MainWindow::displayDefaultOptions()
     ui->lineRandSeed->setText(QString::number(currentParam.randSeed()));
     ui->comboErrorFunc->setCurrentIndex(
                 ui->comboErrorFunc->findData(currentParam.errorFunc()));
+    ui->comboOptimizer->setCurrentIndex(
+                ui->comboOptimizer->findData(currentParam.optimizer()));
+    ui->spinBatchSize->setValue(currentParam.batchSize());
 
     // Group Closs
     ui->spinKernelSize->setValue(currentParam.kernelSize());
@@ -288,13 +314,13 @@ QCPColorScale *MainWindow::createPredictColorScale(QCustomPlot *plot)
 
 QCPColorMap *MainWindow::createPredictMap(QCPAxis *xAxis, QCPAxis *yAxis, QCPColorScale *scale)
 {
-    int nx = 30;
-    int ny = 30;
+    const int resolution = 256;
+    handler->setPredictionResolution(resolution);
 
     // set up the QCPColorMap for prediction plane
     auto map = new QCPColorMap(xAxis, yAxis);
-    // we want the color map to have nx * ny data points
-    map->data()->setSize(nx, ny);
+    // we want the color map to have one cell per grid point
+    map->data()->setSize(resolution, resolution);
     // and span the coordinate range 0..1 in both key (x) and value (y) dimensions
     map->data()->setRange(QCPRange(0, 1), QCPRange(0, 1));
 
@@ -303,13 +329,15 @@ QCPColorMap *MainWindow::createPredictMap(QCPAxis *xAxis, QCPAxis *yAxis, QCPCol
 
     // connect to data change signal
     connect(handler.get(), &UIHandler::predictionUpdated,
-    [=](auto data) {
-        for (auto item : data) {
-            auto point = item.toList();
-            int x, y;
-            map->data()->coordToCell(point[0].toDouble(), point[2].toDouble(), &x, &y);
-            map->data()->setCell(x, y, point[1].toDouble());
-        }
+    [=](auto plane) {
+        auto data = map->data();
+        const int n = plane.count();
+        if (data->keySize() != n || data->valueSize() != n)
+            data->setSize(n, n);
+        const float *values = plane.values();
+        for (int y = 0; y != n; y++)
+            for (int x = 0; x != n; x++)
+                data->setCell(x, y, values[y * n + x]);
         map->parentPlot()->replot();
     });
 
@@ -335,25 +363,23 @@ public:
         }
     }
 
-    void operator ()(QVariantList data)
+    void operator ()(PlotData data)
     {
-        for (auto item : graphAndLabels) {
-            item.second->clearData();
-        }
-
-        for (auto item : data) {
-            auto point = item.toList();
-            auto z = point[1].toDouble();
-            QCPGraph *graph;
-            for (auto item : graphAndLabels) {
-                if (qFuzzyCompare(z, item.first)) {
-                    graph = item.second;
+        QVector<QVector<double>> keys(graphAndLabels.size());
+        QVector<QVector<double>> values(graphAndLabels.size());
+
+        const float *point = data.values();
+        for (int i = 0; i != data.count(); i++, point += 3) {
+            for (int g = 0; g != graphAndLabels.size(); g++) {
+                if (qFuzzyCompare(point[1], float(graphAndLabels[g].first))) {
+                    keys[g].append(point[0]);
+                    values[g].append(point[2]);
                     break;
                 }
             }
-            if (graph) {
-                graph->addData(point[0].toDouble(), point[2].toDouble());
-            }
+        }
+        for (int g = 0; g != graphAndLabels.size(); g++) {
+            graphAndLabels[g].second->setData(keys[g], values[g]);
         }
         if (!graphAndLabels.isEmpty()) {
             // only need to request replot on one graph
@@ -2,6 +2,7 @@
 #include <OpenANN/util/AssertionMacros.h>
 #include <GL/glu.h>
 #include <QApplication>
+#include <algorithm>
 
 #include "ClossNet.h"
 
@@ -11,11 +12,12 @@ TwoSpiralsVisualization::TwoSpiralsVisualization(
     const Eigen::MatrixXd& testInput,
     const Eigen::MatrixXd& testOutput)
     : width(500), height(500),
+      prediction(100, 0.0, 0.99, 0),
+      classes(prediction.values()),
       trainingSet(trainingInput, trainingOutput),
       testSet(testInput, testOutput), showTraining(true), showTest(true),
       showPrediction(true), showSmooth(true), net(new ClossNet)
 {
-    std::memset(classes, 0, sizeof(double) * 100 * 100);
     trainingSet.setVisualization(this);
     QObject::connect(this, SIGNAL(updatedData()), this, SLOT(repaint()));
 
@@ -42,13 +44,13 @@ TwoSpiralsVisualization::~TwoSpiralsVisualization()
     delete net;
 }
 
-void TwoSpiralsVisualization::predictClass(int x, int y, double predictedClass)
+void TwoSpiralsVisualization::predict(Learner& learner)
 {
+    prediction.compute(learner);
     classesMutex.lock();
-    classes[x][y] = predictedClass;
+    classes = prediction.values();
     classesMutex.unlock();
-    if(x == 99 && y == 99)
-        emit updatedData();
+    emit updatedData();
 }
 
 void TwoSpiralsVisualization::initializeGL()
@@ -98,25 +100,27 @@ void TwoSpiralsVisualization::paintGL()
 
 void TwoSpiralsVisualization::paintPrediction()
 {
-    for(int x = 0; x < 100; x++)
+    const int resolution = prediction.resolution();
+    // quads are centered on the grid points
+    const float size = (prediction.maximum() - prediction.minimum())
+                       / std::max(1, resolution - 1);
+    for(int x = 0; x < resolution; x++)
     {
-        for(int y = 0; y < 100; y++)
+        for(int y = 0; y < resolution; y++)
         {
             classesMutex.lock();
             float c;
-            Eigen::VectorXd v(2);
-            v(0) = (double) x / 100.0f;
-            v(1) = (double) y / 100.0f;
+            const float predictedClass = classes[y * resolution + x];
             if(showSmooth)
-                c = classes[x][y] / 2.0f + 0.5f;
+                c = predictedClass / 2.0f + 0.5f;
             else
-                c = classes[x][y] < 0.0 ? 0.0f : 1.0f;
+                c = predictedClass < 0.0 ? 0.0f : 1.0f;
             classesMutex.unlock();
             glColor3f(c, c, c);
-            float minX = (float) x / 100.0f - 0.005;
-            float maxX = minX + 0.01;
-            float minY = (float) y / 100.0f - 0.005;
-            float maxY = minY + 0.01;
+            float minX = (float) prediction.coordinate(x) - size / 2;
+            float maxX = minX + size;
+            float minY = (float) prediction.coordinate(y) - size / 2;
+            float maxY = minY + size;
             glBegin(GL_QUADS);
             glVertex2f(minX, maxY);
             glVertex2f(maxX, maxY);
@@ -194,16 +198,5 @@ void TwoSpiralsDataSet::setVisualization(TwoSpiralsVisualization* visualization)
 void TwoSpiralsDataSet::finishIteration(Learner& learner)
 {
     if(visualization)
-    {
-        for(int x = 0; x < 100; x++)
-        {
-            for(int y = 0; y < 100; y++)
-            {
-                Eigen::VectorXd in(2);
-                in << (double) x / 100.0, (double) y / 100.0;
-                Eigen::VectorXd out = learner(in);
-                visualization->predictClass(x, y, out(0, 0));
-            }
-        }
-    }
+        visualization->predict(learner);
 }
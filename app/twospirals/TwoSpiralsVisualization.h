@@ -8,6 +8,8 @@
 #include <QKeyEvent>
 #include <QMutex>
 #include "ClossNet.h"
+#include "PredictionPlane.h"
+#include <vector>
 
 using namespace OpenANN;
 
@@ -45,7 +47,9 @@ class TwoSpiralsVisualization : public QGLWidget
     Q_OBJECT
     int width, height;
     QMutex classesMutex;
-    double classes[100][100];
+    // computed by the training thread, copied to classes when done
+    PredictionPlane prediction;
+    std::vector<float> classes;
     TwoSpiralsDataSet trainingSet;
     TwoSpiralsDataSet testSet;
     bool showTraining, showTest, showPrediction, showSmooth;
@@ -56,7 +60,7 @@ public:
     TwoSpiralsVisualization(const Eigen::MatrixXd& trainingInput, const Eigen::MatrixXd& trainingOutput,
                             const Eigen::MatrixXd& testInput, const Eigen::MatrixXd& testOutput);
     virtual ~TwoSpiralsVisualization();
-    void predictClass(int x, int y, double predictedClass);
+    void predict(Learner& learner);
 
 protected:
     virtual void initializeGL();
@@ -0,0 +1,541 @@
+#include <OpenANN/ActivationFunctions.h>
+#include <OpenANN/layers/Layer.h>
+#include <OpenANN/optimization/StoppingCriteria.h>
+#include <OpenANN/util/Random.h>
+#include <Eigen/Core>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdarg>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "BPLayer.h"
+#include "ClossKernel.h"
+#include "ClossNet.h"
+#include "CsvLoader.h"
+#include "FixedClossNet.h"
+#include "InterruptableLMA.h"
+#include "WorkerPool.h"
+#include "CreateTwoSpiralsDataSet.h"
+
+/**
+ * Benchmarks of the hot paths of libClossANN.
+ *
+ * Micro-benchmarks cover the Closs kernel, the forward and backward pass
+ * of single BPLayers and the scoring of single inputs, macro-benchmarks
+ * the gradient of a whole network, one LMA iteration and CSV parsing. All
+ * inputs are generated from fixed seeds.
+ * Each benchmark is repeated for at least --min-time seconds and 5 samples,
+ * the median time per run is reported with minimum and mean.
+ *
+ * Usage: closs_bench [--format=table|csv|json] [--filter=text]
+ *                    [--min-time=seconds] [--output=file]
+ *
+ * csv and json are meant for comparing releases, json also records the
+ * instruction set and the number of hardware threads.
+ */
+
+using std::chrono::steady_clock;
+
+namespace
+{
+const int SEED = 42;
+const int MIN_SAMPLES = 5;
+const int MAX_SAMPLES = 1000;
+
+struct Result
+{
+    std::string name;
+    // what is counted by items, e.g. elements or examples
+    std::string unit;
+    double items;
+    int samples;
+    long runs;
+    // seconds per run
+    double min, median, mean;
+};
+
+struct Options
+{
+    Options() : format("table"), minTime(0.5) {}
+    std::string format;
+    std::string filter;
+    double minTime;
+    std::string output;
+};
+
+double secondsSince(steady_clock::time_point start)
+{
+    return std::chrono::duration<double>(steady_clock::now() - start).count();
+}
+
+void seed()
+{
+    std::srand(SEED);
+    OpenANN::RandomNumberGenerator().seed(SEED);
+}
+
+class Suite
+{
+public:
+    explicit Suite(const Options& options) : options(options) {}
+
+    bool enabled(const std::string& name) const
+    {
+        return options.filter.empty() || name.find(options.filter) != std::string::npos;
+    }
+
+    /**
+     * Time body, it is called several times per sample if it is fast.
+     */
+    void run(const std::string& name, double items, const std::string& unit,
+             const std::function<void()>& body)
+    {
+        if(!enabled(name))
+            return;
+        steady_clock::time_point start = steady_clock::now();
+        body();
+        const double once = std::max(secondsSince(start), 1e-9);
+        const long runs = std::max(1L, (long) (options.minTime / MIN_SAMPLES / once));
+
+        std::vector<double> times;
+        const steady_clock::time_point begin = steady_clock::now();
+        while((int) times.size() < MIN_SAMPLES ||
+              ((int) times.size() < MAX_SAMPLES && secondsSince(begin) < options.minTime))
+        {
+            start = steady_clock::now();
+            for(long r = 0; r < runs; r++)
+                body();
+            times.push_back(secondsSince(start) / runs);
+        }
+        add(name, items, unit, runs, times);
+    }
+
+    /**
+     * Time body once per sample after an untimed setup, for benchmarks that
+     * change their state.
+     */
+    void run(const std::string& name, double items, const std::string& unit,
+             const std::function<void()>& setup, const std::function<void()>& body)
+    {
+        if(!enabled(name))
+            return;
+        std::vector<double> times;
+        const steady_clock::time_point begin = steady_clock::now();
+        while((int) times.size() < MIN_SAMPLES ||
+              ((int) times.size() < MAX_SAMPLES && secondsSince(begin) < options.minTime))
+        {
+            setup();
+            const steady_clock::time_point start = steady_clock::now();
+            body();
+            times.push_back(secondsSince(start));
+        }
+        add(name, items, unit, 1, times);
+    }
+
+    void write(std::ostream& out) const
+    {
+        if(options.format == "csv")
+            writeCsv(out);
+        else if(options.format == "json")
+            writeJson(out);
+        else
+            writeTable(out);
+    }
+
+private:
+    void add(const std::string& name, double items, const std::string& unit,
+             long runs, std::vector<double>& times)
+    {
+        std::sort(times.begin(), times.end());
+        Result r;
+        r.name = name;
+        r.unit = unit;
+        r.items = items;
+        r.samples = times.size();
+        r.runs = runs;
+        r.min = times.front();
+        const size_t n = times.size();
+        r.median = n % 2 ? times[n / 2] : 0.5 * (times[n / 2 - 1] + times[n / 2]);
+        double sum = 0.0;
+        for(size_t i = 0; i < n; i++)
+            sum += times[i];
+        r.mean = sum / n;
+        results.push_back(r);
+        // progress, the results are written at the end
+        std::cerr << name << ": " << r.median * 1e3 << " ms" << std::endl;
+    }
+
+    void writeTable(std::ostream& out) const
+    {
+        char line[256];
+        std::snprintf(line, sizeof(line), "%-36s %8s %12s %12s %12s %14s\n", "benchmark",
+                      "samples", "median ms", "min ms", "mean ms", "items/s");
+        out << line;
+        for(size_t i = 0; i < results.size(); i++)
+        {
+            const Result& r = results[i];
+            std::snprintf(line, sizeof(line), "%-36s %8d %12.4f %12.4f %12.4f %14.4g %s\n",
+                          r.name.c_str(), r.samples, r.median * 1e3, r.min * 1e3,
+                          r.mean * 1e3, r.items / r.median, r.unit.c_str());
+            out << line;
+        }
+    }
+
+    void writeCsv(std::ostream& out) const
+    {
+        out << "name,unit,items,samples,runs,min_s,median_s,mean_s,items_per_s\n";
+        char line[256];
+        for(size_t i = 0; i < results.size(); i++)
+        {
+            const Result& r = results[i];
+            std::snprintf(line, sizeof(line), "%s,%s,%.17g,%d,%ld,%.9g,%.9g,%.9g,%.9g\n",
+                          r.name.c_str(), r.unit.c_str(), r.items, r.samples, r.runs,
+                          r.min, r.median, r.mean, r.items / r.median);
+            out << line;
+        }
+    }
+
+    void writeJson(std::ostream& out) const
+    {
+        out << "{\n  \"context\": {\"isa\": \""
+            << ClossKernel::isaName(ClossKernel::bestIsa())
+            << "\", \"hardware_threads\": " << WorkerPool::hardwareThreads()
+            << ", \"eigen\": \"" << EIGEN_WORLD_VERSION << '.' << EIGEN_MAJOR_VERSION
+            << '.' << EIGEN_MINOR_VERSION << "\", \"assertions\": "
+#ifdef NDEBUG
+            << "false"
+#else
+            << "true"
+#endif
+            << ", \"min_time\": " << options.minTime << "},\n  \"benchmarks\": [";
+        char line[512];
+        for(size_t i = 0; i < results.size(); i++)
+        {
+            const Result& r = results[i];
+            std::snprintf(line, sizeof(line),
+                          "%s\n    {\"name\": \"%s\", \"unit\": \"%s\", \"items\": %.17g, "
+                          "\"samples\": %d, \"runs\": %ld, \"min_s\": %.9g, "
+                          "\"median_s\": %.9g, \"mean_s\": %.9g, \"items_per_s\": %.9g}",
+                          i ? "," : "", r.name.c_str(), r.unit.c_str(), r.items,
+                          r.samples, r.runs, r.min, r.median, r.mean, r.items / r.median);
+            out << line;
+        }
+        out << "\n  ]\n}" << std::endl;
+    }
+
+    Options options;
+    std::vector<Result> results;
+};
+
+std::string name(const char* format, ...)
+{
+    char buffer[128];
+    va_list args;
+    va_start(args, format);
+    std::vsnprintf(buffer, sizeof(buffer), format, args);
+    va_end(args);
+    return buffer;
+}
+
+void benchClossKernel(Suite& suite)
+{
+    const int sizes[] = { 1 << 10, 1 << 16, 1 << 20 };
+    const double pValues[] = { 1.0, 1.5, 2.0 };
+    const double kernelSize = 0.5;
+    const double lambda = -1 / (2 * kernelSize * kernelSize);
+    const double beta = 1 / (1 - exp(lambda));
+    ClossKernel kernel;
+    for(int size : sizes)
+    {
+        seed();
+        Eigen::VectorXd x = Eigen::VectorXd::Random(size) * 2;
+        Eigen::VectorXd loss(size), derivative(size);
+        for(double p : pValues)
+        {
+            suite.run(name("closs.function/%d/p%g", size, p), size, "elements", [&]()
+            {
+                kernel(x.data(), loss.data(), 0, size, lambda, beta, p);
+            });
+            suite.run(name("closs.derivative/%d/p%g", size, p), size, "elements", [&]()
+            {
+                kernel(x.data(), loss.data(), derivative.data(), size, lambda, beta, p);
+            });
+        }
+    }
+}
+
+void benchBPLayer(Suite& suite)
+{
+    const int widths[] = { 20, 64, 256 };
+    const int batch = 256;
+    for(int width : widths)
+    {
+        seed();
+        OpenANN::OutputInfo info;
+        info.dimensions.push_back(width);
+        BPLayer layer(info, width, true, OpenANN::TANH, 0.05);
+        std::vector<double*> parameters, derivatives;
+        layer.initialize(parameters, derivatives);
+
+        const Eigen::MatrixXd input = Eigen::MatrixXd::Random(batch, width);
+        const Eigen::MatrixXd deltaIn = Eigen::MatrixXd::Random(batch, width);
+        Eigen::VectorXd gradient(layer.dimension());
+        BPLayer::Workspace ws;
+        suite.run(name("bplayer.forward/%dx%d", width, batch), batch, "examples", [&]()
+        {
+            layer.forwardPropagate(input, ws);
+        });
+        layer.forwardPropagate(input, ws);
+        suite.run(name("bplayer.backward/%dx%d", width, batch), batch, "examples", [&]()
+        {
+            layer.backpropagate(deltaIn, ws, gradient.data(), true);
+        });
+
+        layer.setSinglePrecision(true);
+        const Eigen::MatrixXf singleInput = input.cast<float>();
+        const Eigen::MatrixXf singleDeltaIn = deltaIn.cast<float>();
+        Eigen::VectorXf singleGradient(layer.dimension());
+        BPLayer::WorkspaceF singleWs;
+        suite.run(name("bplayer.forward.float/%dx%d", width, batch), batch, "examples", [&]()
+        {
+            layer.forwardPropagate(singleInput, singleWs);
+        });
+        layer.forwardPropagate(singleInput, singleWs);
+        suite.run(name("bplayer.backward.float/%dx%d", width, batch), batch, "examples", [&]()
+        {
+            layer.backpropagate(singleDeltaIn, singleWs, singleGradient.data(), true);
+        });
+    }
+}
+
+/**
+ * Two inputs in [-1, 1] and a checkerboard of two classes.
+ */
+void syntheticDataSet(int rows, Eigen::MatrixXd& X, Eigen::MatrixXd& T)
+{
+    X = Eigen::MatrixXd::Random(rows, 2);
+    T.resize(rows, 1);
+    for(int n = 0; n < rows; n++)
+        T(n, 0) = std::sin(3.0 * X(n, 0)) * std::cos(3.0 * X(n, 1)) > 0.0 ? 1.0 : -1.0;
+}
+
+void createNet(ClossNet& net, int hidden, int layers, int threads)
+{
+    net.setThreads(threads);
+    net.inputLayer(2);
+    for(int l = 0; l < layers; l++)
+        net.bpLayer(hidden, OpenANN::TANH);
+    net.bpLayer(1, OpenANN::TANH);
+}
+
+void benchErrorGradient(Suite& suite)
+{
+    const int rows = 10000;
+    seed();
+    Eigen::MatrixXd X, T;
+    syntheticDataSet(rows, X, T);
+    std::vector<int> indices(rows);
+    for(int n = 0; n < rows; n++)
+        indices[n] = n;
+
+    const int threads[] = { 1, WorkerPool::hardwareThreads() };
+    for(int t : threads)
+    {
+        for(int single = 0; single < 2; single++)
+        {
+            seed();
+            ClossNet net;
+            createNet(net, 20, 2, t);
+            net.setSinglePrecision(single);
+            net.trainingSet(X, T);
+            net.initialize();
+            double value;
+            Eigen::VectorXd gradient(net.dimension());
+            suite.run(name("net.errorGradient%s/2-20-20-1/%d/threads%d",
+                           single ? ".float" : "", rows, t), rows, "examples", [&]()
+            {
+                net.errorGradient(indices.begin(), indices.end(), value, gradient);
+            });
+        }
+        if(t == 1 && WorkerPool::hardwareThreads() == 1)
+            break;
+    }
+}
+
+/**
+ * Latency of scoring one input with ClossNet and FixedClossNet.
+ */
+void benchScoring(Suite& suite)
+{
+    seed();
+    ClossNet net;
+    createNet(net, 20, 2, 1);
+    net.initialize();
+    net.reserveWorkspaces(1);
+    const Eigen::MatrixXd x = Eigen::MatrixXd::Random(1, 2);
+    Eigen::MatrixXd y;
+    suite.run("score.closs/2-20-20-1", 1, "examples", [&]()
+    {
+        net.predict(0, x, y);
+    });
+
+    const FixedClossNet<2, 20, 20, 1> fixed(net);
+    const FixedClossNet<2, 20, 20, 1>::Input input = x.row(0).transpose();
+    volatile double sink = 0.0;
+    suite.run("score.fixed/2-20-20-1", 1, "examples", [&]()
+    {
+        sink = fixed(input)(0);
+    });
+}
+
+/**
+ * Time the second iteration of InterruptableLMA from the same start.
+ */
+void benchLMAStep(Suite& suite, const std::string& benchName, Eigen::MatrixXd& X,
+                  Eigen::MatrixXd& T, int hidden, int layers)
+{
+    if(!suite.enabled(benchName))
+        return;
+    seed();
+    ClossNet net;
+    createNet(net, hidden, layers, 1);
+    net.trainingSet(X, T);
+    net.initialize();
+    const Eigen::VectorXd start = net.currentParameters();
+
+    OpenANN::StoppingCriteria stop;
+    stop.maximalIterations = 1000;
+    std::unique_ptr<InterruptableLMA> lma;
+    suite.run(benchName, X.rows(), "examples", [&]()
+    {
+        net.setParameters(start);
+        lma.reset(new InterruptableLMA);
+        lma->setThreads(0);
+        lma->setOptimizable(net);
+        lma->setStopCriteria(stop);
+        // the first step also creates alglib's state
+        lma->step();
+    }, [&]()
+    {
+        lma->step();
+    });
+}
+
+void benchLMA(Suite& suite)
+{
+    seed();
+    Eigen::MatrixXd Xtr, Ytr, Xte, Yte;
+    createTwoSpiralsDataSet(2, 1.0, Xtr, Ytr, Xte, Yte);
+    benchLMAStep(suite, "lma.step/twospirals/2-20-20-1", Xtr, Ytr, 20, 2);
+
+    // a small network keeps each run short enough for several samples, the
+    // 400 MB Jacobian of 2-20-20-1 would dominate the runtime of the suite
+    seed();
+    Eigen::MatrixXd X, T;
+    syntheticDataSet(100000, X, T);
+    benchLMAStep(suite, "lma.step/synthetic100k/2-10-1", X, T, 10, 1);
+}
+
+void benchCsv(Suite& suite)
+{
+    const int rows = 100000;
+    const std::string benchName = name("csv.read/%d", rows);
+    if(!suite.enabled(benchName))
+        return;
+
+    const char* fileName = "closs_bench.csv";
+    seed();
+    Eigen::MatrixXd X, T;
+    syntheticDataSet(rows, X, T);
+    {
+        std::ofstream file(fileName);
+        file << "x,y,label\n";
+        char line[128];
+        for(int n = 0; n < rows; n++)
+        {
+            std::snprintf(line, sizeof(line), "%.17g,%.17g,%g\n", X(n, 0), X(n, 1), T(n, 0));
+            file << line;
+        }
+        if(!file)
+        {
+            std::cerr << "Cannot write " << fileName << ", skipping " << benchName << std::endl;
+            return;
+        }
+    }
+    std::ifstream size(fileName, std::ios::binary | std::ios::ate);
+    const double bytes = size.tellg();
+
+    Eigen::MatrixXd input(rows, 2), output(rows, 1);
+    suite.run(benchName, bytes, "bytes", [&]()
+    {
+        CsvLoader loader;
+        loader.open(fileName);
+        loader.read(0, loader.rows(), input, output);
+    });
+    std::remove(fileName);
+}
+
+bool parseOptions(int argc, char** argv, Options& options)
+{
+    for(int i = 1; i < argc; i++)
+    {
+        const std::string arg = argv[i];
+        const size_t eq = arg.find('=');
+        const std::string key = arg.substr(0, eq);
+        const std::string value = eq == std::string::npos ? "" : arg.substr(eq + 1);
+        if(key == "--format" && (value == "table" || value == "csv" || value == "json"))
+            options.format = value;
+        else if(key == "--filter")
+            options.filter = value;
+        else if(key == "--min-time" && std::atof(value.c_str()) > 0.0)
+            options.minTime = std::atof(value.c_str());
+        else if(key == "--output" && !value.empty())
+            options.output = value;
+        else
+            return false;
+    }
+    return true;
+}
+}
+
+int main(int argc, char** argv)
+{
+    Options options;
+    if(!parseOptions(argc, argv, options))
+    {
+        std::cerr << "Usage: " << argv[0] << " [--format=table|csv|json] [--filter=text]"
+                  << " [--min-time=seconds] [--output=file]" << std::endl;
+        return 1;
+    }
+
+    Suite suite(options);
+    benchClossKernel(suite);
+    benchBPLayer(suite);
+    benchErrorGradient(suite);
+    benchScoring(suite);
+    benchLMA(suite);
+    benchCsv(suite);
+
+    if(options.output.empty())
+    {
+        suite.write(std::cout);
+        return 0;
+    }
+    std::ofstream out(options.output.c_str());
+    suite.write(out);
+    if(!out)
+    {
+        std::cerr << "Cannot write " << options.output << std::endl;
+        return 1;
+    }
+    return 0;
+}
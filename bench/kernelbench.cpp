@@ -0,0 +1,61 @@
+#include <Eigen/Core>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+#include "ClossKernel.h"
+
+/**
+ * Micro-benchmark of ClossKernel.
+ *
+ * Evaluates Closs function and derivative on random errors with every
+ * instruction set this CPU supports and prints elements per second and the
+ * largest deviation from the scalar implementation.
+ *
+ * Usage: ClossKernelBench [elements] [repetitions]
+ */
+
+using std::chrono::steady_clock;
+
+int main(int argc, char** argv)
+{
+    const int size = argc > 1 ? std::atoi(argv[1]) : 1 << 16;
+    const int repetitions = argc > 2 ? std::atoi(argv[2]) : 200;
+    const double kernelSize = 0.5;
+    const double lambda = -1 / (2 * kernelSize * kernelSize);
+    const double beta = 1 / (1 - exp(lambda));
+
+    Eigen::VectorXd x = Eigen::VectorXd::Random(size) * 2;
+    Eigen::VectorXd refLoss(size), refDerivative(size);
+    Eigen::VectorXd loss(size), derivative(size);
+
+    std::printf("%-8s %6s %14s %12s\n", "isa", "p", "elements/s", "max error");
+    const double pValues[] = { 1.0, 2.0, 1.5 };
+    for(double p : pValues)
+    {
+        ClossKernel reference(ClossKernel::SCALAR);
+        reference(x.data(), refLoss.data(), refDerivative.data(), size, lambda, beta, p);
+
+        for(int isa = ClossKernel::SCALAR; isa < ClossKernel::ISA_COUNT; isa++)
+        {
+            if(!ClossKernel::supported(ClossKernel::Isa(isa)))
+                continue;
+            ClossKernel kernel((ClossKernel::Isa(isa)));
+
+            const steady_clock::time_point start = steady_clock::now();
+            for(int r = 0; r < repetitions; r++)
+                kernel(x.data(), loss.data(), derivative.data(), size, lambda, beta, p);
+            const double seconds =
+                std::chrono::duration<double>(steady_clock::now() - start).count();
+
+            const double error = std::max((loss - refLoss).cwiseAbs().maxCoeff(),
+                                          (derivative - refDerivative).cwiseAbs().maxCoeff());
+            std::printf("%-8s %6.2f %14.4g %12.3g\n", ClossKernel::isaName(kernel.isa()),
+                        p, double(size) * repetitions / seconds, error);
+        }
+    }
+    return 0;
+}
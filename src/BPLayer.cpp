@@ -1,24 +1,124 @@
 #include "BPLayer.h"
+#include "Profiler.h"
+#include <OpenANN/util/AssertionMacros.h>
 #include <OpenANN/util/Random.h>
+#include <new>
 
 using namespace OpenANN;
 
+namespace
+{
+void activate(ActivationFunction act, const Eigen::MatrixXd& a, Eigen::MatrixXd& z)
+{
+    activationFunction(act, a, z);
+}
+
+void activateDerivative(ActivationFunction act, const Eigen::MatrixXd& z, Eigen::MatrixXd& gd)
+{
+    activationFunctionDerivative(act, z, gd);
+}
+
+// OpenANN implements the activation functions only for doubles
+void activate(ActivationFunction act, const Eigen::MatrixXf& a, Eigen::MatrixXf& z)
+{
+    switch(act)
+    {
+    case LOGISTIC:
+        z.array() = 1.0f / (1.0f + (-a.array().max(-45.0f).min(45.0f)).exp());
+        break;
+    case TANH:
+        z.array() = a.array().tanh();
+        break;
+    case TANH_SCALED:
+        z.array() = 1.7159f * (0.66666667f * a.array()).tanh();
+        break;
+    case RECTIFIER:
+        z.array() = a.array().max(0.0f);
+        break;
+    case LINEAR:
+    default:
+        z = a;
+        break;
+    }
+}
+
+void activateDerivative(ActivationFunction act, const Eigen::MatrixXf& z, Eigen::MatrixXf& gd)
+{
+    switch(act)
+    {
+    case LOGISTIC:
+        gd.array() = z.array() * (1.0f - z.array());
+        break;
+    case TANH:
+        gd.array() = 1.0f - z.array().square();
+        break;
+    case TANH_SCALED:
+        gd.array() = 0.66666667f / 1.7159f * (1.7159f - z.array()) * (1.7159f + z.array());
+        break;
+    case RECTIFIER:
+        gd.array() = (z.array() > 0.0f).cast<float>();
+        break;
+    case LINEAR:
+    default:
+        gd.setOnes();
+        break;
+    }
+}
+}
+
 BPLayer::BPLayer(OutputInfo info, int J, bool bias,
                  ActivationFunction act, double stdDev)
     : nInput(info.outputs()), nUnits(J), hasBias(bias), act(act), stdDev(stdDev),
-      weight(nUnits, nInput), dWeight(nUnits, nInput),
-      prevOutput(0), net(1, nUnits),
-      output(1, nUnits), dAct(1, nUnits),
-      delta(1, nUnits), prevDelta(1, nUnits),
-      bias(nUnits), dBias(nUnits)
+      ownParameters(nUnits * (nInput + hasBias)),
+      ownDerivatives(Eigen::VectorXd::Zero(nUnits * (nInput + hasBias))),
+      weight(0, 0, 0, Eigen::OuterStride<>(1)), dWeight(0, 0, 0, Eigen::OuterStride<>(1)),
+      bias(0, 0, Eigen::InnerStride<>(1)), dBias(0, 0, Eigen::InnerStride<>(1))
 {
+    mapStorage(ownParameters.data(), ownDerivatives.data());
+}
+
+void BPLayer::mapStorage(double* parameters, double* derivatives)
+{
+    // placement new is the documented way to change the array of a Map
+    const int stride = nInput + hasBias;
+    new (&weight) WeightMap(parameters, nUnits, nInput, Eigen::OuterStride<>(stride));
+    new (&dWeight) WeightMap(derivatives, nUnits, nInput, Eigen::OuterStride<>(stride));
+    new (&bias) BiasMap(parameters + nInput, hasBias ? nUnits : 0,
+                        Eigen::InnerStride<>(stride));
+    new (&dBias) BiasMap(derivatives + nInput, hasBias ? nUnits : 0,
+                         Eigen::InnerStride<>(stride));
+}
+
+int BPLayer::dimension() const
+{
+    return nUnits * (nInput + hasBias);
+}
+
+ActivationFunction BPLayer::getActivationFunction() const
+{
+    return act;
+}
+
+int BPLayer::useStorage(double* parameters, double* derivatives, bool keepValues)
+{
+    const int n = dimension();
+    if(keepValues)
+    {
+        Eigen::Map<Eigen::VectorXd>(parameters, n) = Eigen::Map<Eigen::VectorXd>(weight.data(), n);
+        Eigen::Map<Eigen::VectorXd>(derivatives, n) = Eigen::Map<Eigen::VectorXd>(dWeight.data(), n);
+    }
+    mapStorage(parameters, derivatives);
+    ownParameters.resize(0);
+    ownDerivatives.resize(0);
+    updatedParameters();
+    return n;
 }
 
 OutputInfo BPLayer::initialize(std::vector<double*>& parameterPointers,
                                std::vector<double*>& parameterDerivativePointers)
 {
-    parameterPointers.reserve(parameterPointers.size() + nUnits * (nInput + hasBias));
-    parameterDerivativePointers.reserve(parameterDerivativePointers.size() + nUnits * (nInput + hasBias));
+    parameterPointers.reserve(parameterPointers.size() + dimension());
+    parameterDerivativePointers.reserve(parameterDerivativePointers.size() + dimension());
     for(int j = 0; j < nUnits; j++)
     {
         for(int i = 0; i < nInput; i++)
@@ -46,58 +146,153 @@ void BPLayer::initializeParameters()
     rng.fillNormalDistribution(weight, stdDev);
     if(hasBias)
         rng.fillNormalDistribution(bias, stdDev);
+    updatedParameters();
 }
 
 void BPLayer::updatedParameters()
 {
+    if(singleParameters.size())
+        singleParameters = Eigen::Map<Eigen::VectorXd>(weight.data(), dimension()).cast<float>();
+}
+
+void BPLayer::setSinglePrecision(bool enabled)
+{
+    if(!enabled)
+    {
+        singleParameters.resize(0);
+        return;
+    }
+    singleParameters.resize(dimension());
+    updatedParameters();
+}
+
+bool BPLayer::getSinglePrecision() const
+{
+    return singleParameters.size() > 0;
 }
 
 void BPLayer::forwardPropagate(Eigen::MatrixXd* prevOutput, Eigen::MatrixXd*& output, bool, double*)
 {
-    const int nPattern = prevOutput->rows();
-    this->output.conservativeResize(nPattern, Eigen::NoChange);
-    this->prevOutput = prevOutput;
-    // Combine inputs to scalar
-    net = *prevOutput * weight.transpose();
-    if(hasBias)
-        net.rowwise() += bias.transpose();
+    forwardPropagate(*prevOutput, workspace);
+    output = &workspace.output;
+}
+
+void BPLayer::forwardPropagate(const Eigen::MatrixXd& prevOutput, Workspace& ws) const
+{
+    forwardPropagate<double>(weight.data(), prevOutput, ws);
+}
+
+void BPLayer::forwardPropagate(const Eigen::MatrixXf& prevOutput, WorkspaceF& ws) const
+{
+    OPENANN_CHECK_EQUALS(singleParameters.size(), dimension());
+    forwardPropagate<float>(singleParameters.data(), prevOutput, ws);
+}
+
+template<typename Scalar>
+void BPLayer::forwardPropagate(const Scalar* parameters,
+                               const typename BasicWorkspace<Scalar>::Matrix& prevOutput,
+                               BasicWorkspace<Scalar>& ws) const
+{
+    typedef Eigen::Matrix<Scalar, Eigen::Dynamic, Eigen::Dynamic, Eigen::RowMajor> RowMatrix;
+    typedef Eigen::Matrix<Scalar, Eigen::Dynamic, 1> Vector;
+    const int stride = nInput + hasBias;
+    Eigen::Map<const RowMatrix, Eigen::Unaligned, Eigen::OuterStride<> >
+        W(parameters, nUnits, nInput, Eigen::OuterStride<>(stride));
+    Eigen::Map<const Vector, Eigen::Unaligned, Eigen::InnerStride<> >
+        b(parameters + nInput, hasBias ? nUnits : 0, Eigen::InnerStride<>(stride));
+
+    ws.prevOutput = &prevOutput;
+    {
+        CLOSS_PROFILE_SCOPE("gemm forward");
+        // Combine inputs to scalar
+        ws.net.noalias() = prevOutput * W.transpose();
+        if(hasBias)
+            ws.net.rowwise() += b.transpose();
+    }
     // Compute output
-    activationFunction(act, net, this->output);
-    output = &(this->output);
+    CLOSS_PROFILE_SCOPE("activation");
+    ws.output.resize(ws.net.rows(), nUnits);
+    activate(act, ws.net, ws.output);
 }
 
 void BPLayer::backpropagate(Eigen::MatrixXd* deltaIn, Eigen::MatrixXd*& deltaOut,
                             bool backpropToPrevious)
 {
-    const int nPattern = net.rows();
-    dAct.conservativeResize(nPattern, Eigen::NoChange);
-    // Derive activations
-    activationFunctionDerivative(act, net, dAct);
-    delta = dAct.cwiseProduct(*deltaIn);
+    backpropagate(*deltaIn, workspace, dWeight.data(), backpropToPrevious);
+    deltaOut = &workspace.prevDelta;
+}
+
+void BPLayer::backpropagate(const Eigen::MatrixXd& deltaIn, Workspace& ws,
+                            double* derivatives, bool backpropToPrevious) const
+{
+    backpropagate<double>(weight.data(), deltaIn, ws, derivatives, backpropToPrevious);
+}
+
+void BPLayer::backpropagate(const Eigen::MatrixXf& deltaIn, WorkspaceF& ws,
+                            float* derivatives, bool backpropToPrevious) const
+{
+    OPENANN_CHECK_EQUALS(singleParameters.size(), dimension());
+    backpropagate<float>(singleParameters.data(), deltaIn, ws, derivatives,
+                         backpropToPrevious);
+}
+
+template<typename Scalar>
+void BPLayer::backpropagate(const Scalar* parameters,
+                            const typename BasicWorkspace<Scalar>::Matrix& deltaIn,
+                            BasicWorkspace<Scalar>& ws, Scalar* derivatives,
+                            bool backpropToPrevious) const
+{
+    typedef Eigen::Matrix<Scalar, Eigen::Dynamic, Eigen::Dynamic, Eigen::RowMajor> RowMatrix;
+    typedef Eigen::Matrix<Scalar, Eigen::Dynamic, 1> Vector;
+    const int stride = nInput + hasBias;
+    {
+        CLOSS_PROFILE_SCOPE("activation derivative");
+        // Derive activations
+        ws.dAct.resize(ws.output.rows(), nUnits);
+        activateDerivative(act, ws.output, ws.dAct);
+        ws.delta = ws.dAct.cwiseProduct(deltaIn);
+    }
+    CLOSS_PROFILE_SCOPE("gemm backward");
     // Weight derivatives
-    dWeight = delta.transpose() **prevOutput;
-    if(hasBias)
-        dBias = delta.colwise().sum().transpose();
+    if(derivatives)
+    {
+        Eigen::Map<RowMatrix, Eigen::Unaligned, Eigen::OuterStride<> >
+            dW(derivatives, nUnits, nInput, Eigen::OuterStride<>(stride));
+        dW.noalias() = ws.delta.transpose() * *ws.prevOutput;
+        if(hasBias)
+            Eigen::Map<Vector, Eigen::Unaligned, Eigen::InnerStride<> >(
+                derivatives + nInput, nUnits, Eigen::InnerStride<>(stride)) =
+                ws.delta.colwise().sum().transpose();
+    }
     // Prepare error signals for previous layer
     if(backpropToPrevious)
-        prevDelta = delta * weight;
-    deltaOut = &prevDelta;
+        ws.prevDelta.noalias() = ws.delta * Eigen::Map<const RowMatrix, Eigen::Unaligned,
+                                 Eigen::OuterStride<> >(parameters, nUnits, nInput,
+                                                        Eigen::OuterStride<>(stride));
 }
 
 Eigen::MatrixXd& BPLayer::getOutput()
 {
-    return output;
+    return workspace.output;
 }
 
 Eigen::VectorXd BPLayer::getParameters()
 {
-    Eigen::VectorXd p(nUnits * (nInput + hasBias));
-    int idx = 0;
-    for(int j = 0; j < nUnits; j++)
-        for(int i = 0; i < nInput; i++)
-            p(idx++) = weight(j, i);
-    if(hasBias)
-        for(int j = 0; j < nUnits; j++)
-            p(idx++) = bias(j);
-    return p;
+    return Eigen::Map<const Eigen::VectorXd>(weight.data(), dimension());
+}
+
+int BPLayer::jacobian(const Workspace& ws, double* const* rows, int offset) const
+{
+    CLOSS_PROFILE_SCOPE("jacobian rows");
+    const int stride = nInput + hasBias;
+    for(int n = 0; n < ws.delta.rows(); n++)
+    {
+        // outer product of delta and input of pattern n
+        WeightMap dW(rows[n] + offset, nUnits, nInput, Eigen::OuterStride<>(stride));
+        dW.noalias() = ws.delta.row(n).transpose() * ws.prevOutput->row(n);
+        if(hasBias)
+            BiasMap(rows[n] + offset + nInput, nUnits, Eigen::InnerStride<>(stride)) =
+                ws.delta.row(n).transpose();
+    }
+    return dimension();
 }
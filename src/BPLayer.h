@@ -19,39 +19,88 @@ using OpenANN::OutputInfo;
  * output, \f$ g \f$ a typically nonlinear activation function that operates
  * on a vector, \f$ x \f$ is the input of the layer, \f$ W \f$ is a weight
  * matrix and \f$ b \f$ is a bias vector.
+ *
+ * Weights and biases are stored in one contiguous row-major block
+ * \f$ [W | b] \f$, in the same order as the parameter pointers are
+ * registered. The block can be moved into storage owned by the network with
+ * useStorage() so that all layers share one parameter and one gradient
+ * vector.
+ *
+ * With setSinglePrecision() the layer also keeps a float copy of the block,
+ * which is used by the float overloads of the workspace functions. The
+ * copy is updated by updatedParameters().
  */
 class BPLayer : public Layer
 {
+public:
+    typedef Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic, Eigen::RowMajor> RowMatrixXd;
+    typedef Eigen::Map<RowMatrixXd, Eigen::Unaligned, Eigen::OuterStride<> > WeightMap;
+    typedef Eigen::Map<Eigen::VectorXd, Eigen::Unaligned, Eigen::InnerStride<> > BiasMap;
+
+    /**
+     * Intermediate results of one forward and backward pass.
+     *
+     * The layer's own propagation uses an internal workspace. Threads that
+     * propagate different patterns through the same layer concurrently must
+     * each use their own workspace.
+     */
+    template<typename Scalar>
+    struct BasicWorkspace
+    {
+        typedef Eigen::Matrix<Scalar, Eigen::Dynamic, Eigen::Dynamic> Matrix;
+
+        // pointer to previous layer's output. nInput cols, each row is a pattern
+        const Matrix* prevOutput;
+        // act func input. nUnits cols, each row is a pattern
+        Matrix net;
+        // output matrix. nUnits cols, each row is a pattern
+        Matrix output;
+        // derivation of act func.
+        Matrix dAct;
+        // deltas used in bp
+        Matrix delta;
+        // store deltaOut for previous layer
+        Matrix prevDelta;
+
+        BasicWorkspace() : prevOutput(0) {}
+    };
+    typedef BasicWorkspace<double> Workspace;
+    typedef BasicWorkspace<float> WorkspaceF;
+
 protected:
     int nInput, nUnits;
     bool hasBias;
     ActivationFunction act;
     double stdDev;
 
-    // weight matrix. nUnits rows and nInputs cols
-    Eigen::MatrixXd weight;
-    Eigen::MatrixXd dWeight;
-
-    // pointer to previous layer's output. nInput cols, each row is a pattern
-    Eigen::MatrixXd* prevOutput;
+    // parameters and derivatives until useStorage() is called
+    Eigen::VectorXd ownParameters;
+    Eigen::VectorXd ownDerivatives;
 
-    // act func input. nUnits cols, each row is a pattern
-    Eigen::MatrixXd net;
+    // weight matrix. nUnits rows and nInputs cols
+    WeightMap weight;
+    WeightMap dWeight;
 
-    // output matrix. nUnits cols, each row is a pattern
-    Eigen::MatrixXd output;
+    // intermediate results of forwardPropagate() and backpropagate()
+    Workspace workspace;
 
-    // derivation of act func.
-    Eigen::MatrixXd dAct;
+    // bias vector, last column of the parameter block
+    BiasMap bias;
+    BiasMap dBias;
 
-    // deltas used in bp
-    Eigen::MatrixXd delta;
-    // store deltaOut for previous layer
-    Eigen::MatrixXd prevDelta;
+    // float copy of the parameter block, empty if single precision is off
+    Eigen::VectorXf singleParameters;
 
-    // bias vector
-    Eigen::VectorXd bias;
-    Eigen::VectorXd dBias;
+    void mapStorage(double* parameters, double* derivatives);
+    template<typename Scalar>
+    void forwardPropagate(const Scalar* parameters,
+                          const typename BasicWorkspace<Scalar>::Matrix& prevOutput,
+                          BasicWorkspace<Scalar>& ws) const;
+    template<typename Scalar>
+    void backpropagate(const Scalar* parameters,
+                       const typename BasicWorkspace<Scalar>::Matrix& deltaIn,
+                       BasicWorkspace<Scalar>& ws, Scalar* derivatives,
+                       bool backpropToPrevious) const;
 
 public:
     BPLayer(OutputInfo info, int nUnits, bool hasBias, ActivationFunction act, double stdDev);
@@ -63,7 +112,77 @@ public:
     virtual void backpropagate(Eigen::MatrixXd* deltaIn, Eigen::MatrixXd*& deltaOut,
                                bool backpropToPrevious);
     virtual Eigen::MatrixXd& getOutput();
+    /**
+     * @return copy of the parameter block, [W|b] row by row like the
+     *         parameters registered in initialize()
+     */
     virtual Eigen::VectorXd getParameters();
+
+    /**
+     * Forward propagation that does not modify the layer.
+     * @param prevOutput output of the previous layer, must outlive ws
+     * @param ws workspace that receives the output
+     */
+    void forwardPropagate(const Eigen::MatrixXd& prevOutput, Workspace& ws) const;
+    /**
+     * Backpropagation that does not modify the layer.
+     * @param deltaIn derivative of the error w.r.t. the output in ws
+     * @param ws workspace of the last forwardPropagate()
+     * @param derivatives receives the summed derivatives, dimension() values
+     *                    in the same layout as the parameters, may be null
+     * @param backpropToPrevious compute ws.prevDelta
+     */
+    void backpropagate(const Eigen::MatrixXd& deltaIn, Workspace& ws,
+                       double* derivatives, bool backpropToPrevious) const;
+    /**
+     * @name Single Precision
+     * Same as the double versions with the float copy of the parameters,
+     * requires setSinglePrecision().
+     */
+    ///@{
+    void forwardPropagate(const Eigen::MatrixXf& prevOutput, WorkspaceF& ws) const;
+    /**
+     * @param derivatives receives the summed derivatives as floats
+     */
+    void backpropagate(const Eigen::MatrixXf& deltaIn, WorkspaceF& ws,
+                       float* derivatives, bool backpropToPrevious) const;
+    ///@}
+    /**
+     * Keep a float copy of the parameters for the single precision
+     * functions.
+     */
+    void setSinglePrecision(bool enabled);
+    bool getSinglePrecision() const;
+    /**
+     * Write the per-pattern derivatives of a backpropagation into Jacobian
+     * rows.
+     * @param ws workspace of the last backpropagate()
+     * @param rows rows[n] receives the derivatives of pattern n
+     * @param offset index of this layer's first parameter in each row
+     * @return dimension()
+     */
+    int jacobian(const Workspace& ws, double* const* rows, int offset) const;
+
+    /**
+     * @return number of parameters of this layer
+     */
+    int dimension() const;
+    ActivationFunction getActivationFunction() const;
+    /**
+     * Move parameters and derivatives to external storage.
+     *
+     * The storage must hold dimension() values each and must outlive the
+     * layer or the next call. Parameter pointers registered in initialize()
+     * are invalidated.
+     *
+     * @param parameters new parameter storage
+     * @param derivatives new derivative storage
+     * @param keepValues copy the current values to the new location,
+     *                   otherwise the layer uses the values found there
+     * @return dimension()
+     */
+    virtual int useStorage(double* parameters, double* derivatives,
+                           bool keepValues = true);
 };
 
 #endif // BPLAYER_H_
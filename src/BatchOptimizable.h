@@ -0,0 +1,58 @@
+#ifndef BATCHOPTIMIZABLE_H_
+#define BATCHOPTIMIZABLE_H_
+
+#include <Eigen/Core>
+
+/**
+ * @class BatchOptimizable
+ *
+ * Optimizable that can evaluate the residuals and the Jacobian of many
+ * training examples at once.
+ *
+ * OpenANN::Optimizable only offers error(n) and errorGradient(n, ...), which
+ * forces least squares optimizers to evaluate one example at a time.
+ * Implementations of this interface compute the residuals of a block of
+ * examples in one forward pass and their Jacobian rows in one backward pass,
+ * possibly for several blocks in parallel. Optimizers detect this
+ * interface with a dynamic_cast and fall back to the per-example functions
+ * if it is not available.
+ */
+class BatchOptimizable
+{
+public:
+    virtual ~BatchOptimizable() {}
+
+    /**
+     * Check if the batched functions can be used with the current setup.
+     * @return true if errors() and errorJacobian() are available
+     */
+    virtual bool providesJacobian() = 0;
+    /**
+     * Compute the residual of each training example.
+     * @param values residuals, one entry per example, same as error(n)
+     */
+    virtual void errors(Eigen::VectorXd& values) = 0;
+    /**
+     * Allocate scratch memory for concurrent calls of the tile functions.
+     * @param count number of workspaces
+     */
+    virtual void reserveWorkspaces(int count) = 0;
+    /**
+     * Compute residuals and Jacobian rows of the examples [startN, endN).
+     *
+     * Calls for disjoint ranges may run concurrently if each call uses its
+     * own workspace.
+     *
+     * @param workspace index of the scratch memory, less than the count
+     *                  passed to reserveWorkspaces()
+     * @param startN first example
+     * @param endN one past the last example
+     * @param values receives endN - startN residuals
+     * @param rows rows[n - startN] receives the dimension() derivatives of
+     *             example n, only the residuals are computed if null
+     */
+    virtual void errorJacobian(int workspace, int startN, int endN,
+                               double* values, double* const* rows) = 0;
+};
+
+#endif // BATCHOPTIMIZABLE_H_
@@ -0,0 +1,117 @@
+#include "ClassificationEvaluator.h"
+#include "MatrixDataSet.h"
+#include "Profiler.h"
+#include "StreamingDataSet.h"
+#include <OpenANN/util/AssertionMacros.h>
+#include <OpenANN/util/OpenANNException.h>
+#include <algorithm>
+#include <cmath>
+
+using OpenANN::OpenANNException;
+
+ClassificationEvaluator::ClassificationEvaluator(double kernelSize, double pValue,
+                                                 double gate, int blockRows)
+    : lambda(-1 / (2 * kernelSize * kernelSize)), beta(1 / (1 - std::exp(lambda))),
+      pValue(pValue), gate(gate), blockRows(blockRows), samples(0), correct(0),
+      clossSum(0.0), squaredSum(0.0), outputs(0)
+{
+    if(kernelSize <= 0.0)
+        throw OpenANNException("Kernel size must be positive.");
+    if(blockRows <= 0)
+        throw OpenANNException("Block size must be positive.");
+}
+
+ClassificationEvaluator::Result ClassificationEvaluator::evaluate(
+        Learner& learner, const Eigen::MatrixXd& input, const Eigen::MatrixXd& output)
+{
+    OPENANN_CHECK_EQUALS(input.rows(), output.rows());
+    reset();
+    const int n = input.rows();
+    if(n <= blockRows)
+    {
+        accumulate(learner, input, output);
+        return result();
+    }
+    for(int start = 0; start < n; start += blockRows)
+    {
+        const int rows = std::min(blockRows, n - start);
+        block = input.middleRows(start, rows);
+        accumulate(learner, block, output.middleRows(start, rows));
+    }
+    return result();
+}
+
+ClassificationEvaluator::Result ClassificationEvaluator::evaluate(
+        Learner& learner, DataSet& dataSet)
+{
+    MatrixDataSet* matrixSet = dynamic_cast<MatrixDataSet*>(&dataSet);
+    if(matrixSet)
+        return evaluate(learner, matrixSet->inputMatrix(), matrixSet->outputMatrix());
+
+    reset();
+    StreamingDataSet* streamingSet = dynamic_cast<StreamingDataSet*>(&dataSet);
+    if(streamingSet)
+    {
+        streamingSet->forEachChunk([&](const Eigen::MatrixXd& in,
+                                       const Eigen::MatrixXd& out, int)
+        {
+            accumulate(learner, in, out);
+        });
+        return result();
+    }
+
+    const int n = dataSet.samples();
+    Eigen::MatrixXd target;
+    for(int start = 0; start < n; start += blockRows)
+    {
+        const int rows = std::min(blockRows, n - start);
+        block.resize(rows, dataSet.inputs());
+        target.resize(rows, dataSet.outputs());
+        for(int i = 0; i < rows; i++)
+        {
+            block.row(i) = dataSet.getInstance(start + i);
+            target.row(i) = dataSet.getTarget(start + i);
+        }
+        accumulate(learner, block, target);
+    }
+    return result();
+}
+
+void ClassificationEvaluator::reset()
+{
+    samples = 0;
+    correct = 0;
+    clossSum = 0.0;
+    squaredSum = 0.0;
+    outputs = 0;
+}
+
+void ClassificationEvaluator::accumulate(Learner& learner, const Eigen::MatrixXd& input,
+                                         const Eigen::Ref<const Eigen::MatrixXd>& output)
+{
+    if(input.rows() == 0)
+        return;
+    CLOSS_PROFILE_SCOPE("evaluation");
+    residual = learner(input);
+    OPENANN_CHECK_EQUALS(residual.rows(), output.rows());
+    OPENANN_CHECK_EQUALS(residual.cols(), output.cols());
+    residual -= output;
+
+    correct += (residual.array().abs() <= gate).rowwise().all().count();
+    squaredSum += residual.squaredNorm();
+    loss.resize(residual.rows(), residual.cols());
+    kernel(residual.data(), loss.data(), 0, residual.size(), lambda, beta, pValue);
+    clossSum += loss.sum();
+    samples += residual.rows();
+    outputs += residual.size();
+}
+
+ClassificationEvaluator::Result ClassificationEvaluator::result() const
+{
+    Result r;
+    r.samples = samples;
+    r.rate = samples ? correct * 100.0 / samples : 0.0;
+    r.closs = samples ? clossSum / samples : 0.0;
+    r.mse = outputs ? squaredSum / outputs : 0.0;
+    return r;
+}
@@ -0,0 +1,75 @@
+#ifndef CLASSIFICATIONEVALUATOR_H_
+#define CLASSIFICATIONEVALUATOR_H_
+
+#include <OpenANN/Learner.h>
+#include <OpenANN/io/DataSet.h>
+#include <Eigen/Core>
+#include "ClossKernel.h"
+
+using OpenANN::DataSet;
+using OpenANN::Learner;
+
+/**
+ * @class ClassificationEvaluator
+ *
+ * Classification rate, Closs and MSE of a learner in one pass.
+ *
+ * Examples are forwarded through the learner in blocks of rows instead of
+ * one by one. An example is classified correctly if all of its outputs lie
+ * within the gate of the targets. The Closs is computed with ClossKernel
+ * from the same outputs, so it is available for networks trained with any
+ * error function.
+ */
+class ClassificationEvaluator
+{
+public:
+    struct Result
+    {
+        int samples;
+        //! percentage of correctly classified examples
+        double rate;
+        //! mean Closs of an example, same as ClossNet::error()
+        double closs;
+        //! mean squared error of an output
+        double mse;
+    };
+
+    /**
+     * @param kernelSize kernel size of the Closs function
+     * @param pValue p value of the Closs function
+     * @param gate maximal distance of a correct output to its target
+     * @param blockRows number of examples that are forwarded at once
+     */
+    ClassificationEvaluator(double kernelSize = 0.5, double pValue = 2.0,
+                            double gate = 0.8, int blockRows = 4096);
+
+    /**
+     * Evaluate examples stored in rows of two matrices.
+     */
+    Result evaluate(Learner& learner, const Eigen::MatrixXd& input,
+                    const Eigen::MatrixXd& output);
+    /**
+     * Evaluate a data set. Matrices of a MatrixDataSet are used directly, a
+     * StreamingDataSet is read chunk by chunk, instances of other data sets
+     * are gathered in blocks.
+     */
+    Result evaluate(Learner& learner, DataSet& dataSet);
+
+private:
+    void reset();
+    void accumulate(Learner& learner, const Eigen::MatrixXd& input,
+                    const Eigen::Ref<const Eigen::MatrixXd>& output);
+    Result result() const;
+
+    double lambda, beta, pValue, gate;
+    int blockRows;
+    ClossKernel kernel;
+    Eigen::MatrixXd block, residual, loss;
+    // sums of the current evaluation
+    int samples;
+    long correct;
+    double clossSum, squaredSum;
+    long outputs;
+};
+
+#endif // CLASSIFICATIONEVALUATOR_H_
@@ -0,0 +1,152 @@
+#include "ClossKernel.h"
+#include "ClossKernelImpl.h"
+#include <OpenANN/util/OpenANNException.h>
+#include <cmath>
+
+namespace
+{
+
+void clossScalar(const double* x, double* loss, double* derivative,
+                 int size, double lambda, double beta, double p)
+{
+    const double dScale = -beta * lambda * p;
+
+    if(p == 2.0)
+    {
+        for(int i = 0; i < size; i++)
+        {
+            const double rbf = exp(lambda * x[i] * x[i]);
+            loss[i] = beta * (1 - rbf);
+            if(derivative)
+                derivative[i] = dScale * rbf * x[i];
+        }
+    }
+    else if(p == 1.0)
+    {
+        for(int i = 0; i < size; i++)
+        {
+            const double rbf = exp(lambda * std::abs(x[i]));
+            loss[i] = beta * (1 - rbf);
+            if(derivative)
+                derivative[i] = std::copysign(dScale * rbf, x[i]);
+        }
+    }
+    else
+    {
+        for(int i = 0; i < size; i++)
+        {
+            const double a = std::abs(x[i]);
+            const double apm1 = pow(a, p - 1);
+            const double ap = a > 0 ? a * apm1 : 0.0;
+            const double rbf = exp(lambda * ap);
+            loss[i] = beta * (1 - rbf);
+            if(derivative)
+                derivative[i] = std::copysign(dScale * rbf * apm1, x[i]);
+        }
+    }
+}
+
+ClossKernel::Function kernelFunction(ClossKernel::Isa isa)
+{
+    switch(isa)
+    {
+    case ClossKernel::SCALAR:
+        return clossKernelScalar();
+    case ClossKernel::SSE2:
+        return clossKernelSSE2();
+    case ClossKernel::AVX2:
+        return clossKernelAVX2();
+    case ClossKernel::AVX512:
+        return clossKernelAVX512();
+    default:
+        return 0;
+    }
+}
+
+bool cpuSupports(ClossKernel::Isa isa)
+{
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+    switch(isa)
+    {
+    case ClossKernel::SCALAR:
+        return true;
+    case ClossKernel::SSE2:
+        return __builtin_cpu_supports("sse2");
+    case ClossKernel::AVX2:
+        return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+    case ClossKernel::AVX512:
+        return __builtin_cpu_supports("avx512f");
+    default:
+        return false;
+    }
+#else
+    return isa == ClossKernel::SCALAR;
+#endif
+}
+
+} // namespace
+
+ClossKernel::Function clossKernelScalar()
+{
+    return &clossScalar;
+}
+
+ClossKernel::ClossKernel()
+    : kernelIsa(bestIsa()), function(kernelFunction(kernelIsa))
+{
+}
+
+ClossKernel::ClossKernel(Isa isa)
+    : kernelIsa(isa), function(0)
+{
+    if(!supported(isa))
+        throw OpenANN::OpenANNException(std::string("Closs kernel not supported: ")
+                                        + isaName(isa));
+    function = kernelFunction(isa);
+}
+
+void ClossKernel::operator()(const double* x, double* loss, double* derivative,
+                             int size, double lambda, double beta, double p) const
+{
+    function(x, loss, derivative, size, lambda, beta, p);
+}
+
+ClossKernel::Isa ClossKernel::isa() const
+{
+    return kernelIsa;
+}
+
+bool ClossKernel::supported(Isa isa)
+{
+    return kernelFunction(isa) && cpuSupports(isa);
+}
+
+ClossKernel::Isa ClossKernel::bestIsa()
+{
+    static const Isa best = [] {
+        for(int isa = ISA_COUNT - 1; isa > SCALAR; isa--)
+        {
+            if(supported(Isa(isa)))
+                return Isa(isa);
+        }
+        return SCALAR;
+    }();
+    return best;
+}
+
+const char* ClossKernel::isaName(Isa isa)
+{
+    switch(isa)
+    {
+    case SCALAR:
+        return "scalar";
+    case SSE2:
+        return "SSE2";
+    case AVX2:
+        return "AVX2";
+    case AVX512:
+        return "AVX-512";
+    default:
+        return "unknown";
+    }
+}
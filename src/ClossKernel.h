@@ -0,0 +1,71 @@
+#ifndef CLOSSKERNEL_H_
+#define CLOSSKERNEL_H_
+
+/**
+ * @class ClossKernel
+ *
+ * Vectorized evaluation of the Closs function and its derivative.
+ *
+ * Computes \f$ l = \beta (1 - e^{\lambda |x|^p}) \f$ and
+ * \f$ \frac{\partial l}{\partial x} = -\beta \lambda p e^{\lambda |x|^p}
+ * |x|^{p-1} sign(x) \f$ element-wise. There is one implementation per
+ * instruction set, each compiled with its own compiler flags. The best one
+ * that the running CPU supports is chosen at runtime, so a single binary
+ * runs at full speed on SSE2, AVX2 and AVX-512 machines.
+ */
+class ClossKernel
+{
+public:
+    enum Isa
+    {
+        SCALAR,
+        SSE2,
+        AVX2,
+        AVX512,
+        ISA_COUNT
+    };
+
+    typedef void (*Function)(const double* x, double* loss, double* derivative,
+                             int size, double lambda, double beta, double p);
+
+    /**
+     * Create kernel using the best instruction set of this CPU.
+     */
+    ClossKernel();
+    /**
+     * Create kernel using a specific instruction set.
+     * @param isa must be supported, see supported()
+     */
+    explicit ClossKernel(Isa isa);
+
+    /**
+     * Evaluate Closs function.
+     * @param x input, e.g. output minus target
+     * @param loss Closs of each element, same size as x
+     * @param derivative derivative of each element, may be null
+     * @param size number of elements
+     * @param lambda \f$ -1 / (2 \sigma^2) \f$
+     * @param beta \f$ 1 / (1 - e^{\lambda}) \f$
+     * @param p p value
+     */
+    void operator()(const double* x, double* loss, double* derivative,
+                    int size, double lambda, double beta, double p) const;
+
+    Isa isa() const;
+
+    /**
+     * Check if the instruction set is compiled in and supported by this CPU.
+     */
+    static bool supported(Isa isa);
+    /**
+     * @return the fastest supported instruction set
+     */
+    static Isa bestIsa();
+    static const char* isaName(Isa isa);
+
+private:
+    Isa kernelIsa;
+    Function function;
+};
+
+#endif // CLOSSKERNEL_H_
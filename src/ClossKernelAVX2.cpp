@@ -0,0 +1,71 @@
+#include "ClossKernelImpl.h"
+
+#if defined(__AVX2__) && defined(__FMA__)
+#include <immintrin.h>
+
+namespace
+{
+
+struct Avx2Ops
+{
+    typedef __m256d Packet;
+    typedef __m256d Mask;
+    enum { size = 4 };
+
+    static inline Packet load(const double* p) { return _mm256_loadu_pd(p); }
+    static inline void store(double* p, Packet a) { _mm256_storeu_pd(p, a); }
+    static inline Packet set1(double a) { return _mm256_set1_pd(a); }
+    static inline Packet add(Packet a, Packet b) { return _mm256_add_pd(a, b); }
+    static inline Packet sub(Packet a, Packet b) { return _mm256_sub_pd(a, b); }
+    static inline Packet mul(Packet a, Packet b) { return _mm256_mul_pd(a, b); }
+    static inline Packet div(Packet a, Packet b) { return _mm256_div_pd(a, b); }
+    static inline Packet fmadd(Packet a, Packet b, Packet c) { return _mm256_fmadd_pd(a, b, c); }
+    static inline Packet min(Packet a, Packet b) { return _mm256_min_pd(a, b); }
+    static inline Packet max(Packet a, Packet b) { return _mm256_max_pd(a, b); }
+    static inline Packet abs(Packet a) { return _mm256_andnot_pd(_mm256_set1_pd(-0.0), a); }
+    static inline Packet copysign(Packet magnitude, Packet sign)
+    {
+        const __m256d signMask = _mm256_set1_pd(-0.0);
+        return _mm256_or_pd(_mm256_andnot_pd(signMask, magnitude),
+                            _mm256_and_pd(signMask, sign));
+    }
+    static inline Mask greater(Packet a, Packet b) { return _mm256_cmp_pd(a, b, _CMP_GT_OQ); }
+    static inline Packet select(Mask m, Packet a, Packet b) { return _mm256_blendv_pd(b, a, m); }
+    // 2^n for integral n in [-1022, 1023]
+    static inline Packet pow2n(Packet n)
+    {
+        const __m256d magic = _mm256_set1_pd(6755399441055744.0);
+        __m256i k = _mm256_sub_epi64(_mm256_castpd_si256(_mm256_add_pd(n, magic)),
+                                     _mm256_castpd_si256(magic));
+        k = _mm256_slli_epi64(_mm256_add_epi64(k, _mm256_set1_epi64x(1023)), 52);
+        return _mm256_castsi256_pd(k);
+    }
+    // x = m * 2^e with m in [1, 2), x > 0
+    static inline Packet frexp(Packet x, Packet& e)
+    {
+        const __m256i bits = _mm256_castpd_si256(x);
+        const __m256d two52 = _mm256_set1_pd(4503599627370496.0);
+        e = _mm256_sub_pd(_mm256_castsi256_pd(_mm256_or_si256(_mm256_srli_epi64(bits, 52),
+                                                               _mm256_castpd_si256(two52))),
+                          _mm256_add_pd(two52, _mm256_set1_pd(1023.0)));
+        return _mm256_castsi256_pd(_mm256_or_si256(
+                                       _mm256_and_si256(bits, _mm256_set1_epi64x(0x000FFFFFFFFFFFFFLL)),
+                                       _mm256_set1_epi64x(0x3FF0000000000000LL)));
+    }
+};
+
+} // namespace
+
+ClossKernel::Function clossKernelAVX2()
+{
+    return &clossKernel<Avx2Ops>;
+}
+
+#else
+
+ClossKernel::Function clossKernelAVX2()
+{
+    return 0;
+}
+
+#endif
@@ -0,0 +1,110 @@
+#include "ClossKernelImpl.h"
+
+#ifdef __AVX512F__
+#include <immintrin.h>
+
+namespace
+{
+
+/*
+ * GCC implements the unmasked forms of some intrinsics with the masked
+ * builtin and an uninitialized source, which -Wmaybe-uninitialized reports
+ * once they are inlined. The masked forms with a zero source and all lanes
+ * selected are used instead, they compile to the same instruction.
+ */
+const __mmask8 ALL_LANES = 0xFF;
+
+inline __m512d max_pd(__m512d a, __m512d b)
+{
+    return _mm512_mask_max_pd(_mm512_setzero_pd(), ALL_LANES, a, b);
+}
+
+inline __m512d min_pd(__m512d a, __m512d b)
+{
+    return _mm512_mask_min_pd(_mm512_setzero_pd(), ALL_LANES, a, b);
+}
+
+inline __m512i slli_epi64(__m512i a, unsigned int n)
+{
+    return _mm512_mask_slli_epi64(_mm512_setzero_si512(), ALL_LANES, a, n);
+}
+
+inline __m512i srli_epi64(__m512i a, unsigned int n)
+{
+    return _mm512_mask_srli_epi64(_mm512_setzero_si512(), ALL_LANES, a, n);
+}
+
+inline __m512i andnot_si512(__m512i a, __m512i b)
+{
+    return _mm512_mask_andnot_epi64(_mm512_setzero_si512(), ALL_LANES, a, b);
+}
+
+struct Avx512Ops
+{
+    typedef __m512d Packet;
+    typedef __mmask8 Mask;
+    enum { size = 8 };
+
+    static inline Packet load(const double* p) { return _mm512_loadu_pd(p); }
+    static inline void store(double* p, Packet a) { _mm512_storeu_pd(p, a); }
+    static inline Packet set1(double a) { return _mm512_set1_pd(a); }
+    static inline Packet add(Packet a, Packet b) { return _mm512_add_pd(a, b); }
+    static inline Packet sub(Packet a, Packet b) { return _mm512_sub_pd(a, b); }
+    static inline Packet mul(Packet a, Packet b) { return _mm512_mul_pd(a, b); }
+    static inline Packet div(Packet a, Packet b) { return _mm512_div_pd(a, b); }
+    static inline Packet fmadd(Packet a, Packet b, Packet c) { return _mm512_fmadd_pd(a, b, c); }
+    static inline Packet min(Packet a, Packet b) { return min_pd(a, b); }
+    static inline Packet max(Packet a, Packet b) { return max_pd(a, b); }
+    // AVX-512F has no floating point bit operations, use the integer ones
+    static inline Packet abs(Packet a)
+    {
+        return _mm512_castsi512_pd(_mm512_and_si512(_mm512_castpd_si512(a),
+                                                    _mm512_set1_epi64(0x7FFFFFFFFFFFFFFFLL)));
+    }
+    static inline Packet copysign(Packet magnitude, Packet sign)
+    {
+        const __m512i signMask = _mm512_set1_epi64(0x8000000000000000ULL);
+        return _mm512_castsi512_pd(_mm512_or_si512(
+                                       andnot_si512(signMask, _mm512_castpd_si512(magnitude)),
+                                       _mm512_and_si512(signMask, _mm512_castpd_si512(sign))));
+    }
+    static inline Mask greater(Packet a, Packet b) { return _mm512_cmp_pd_mask(a, b, _CMP_GT_OQ); }
+    static inline Packet select(Mask m, Packet a, Packet b) { return _mm512_mask_blend_pd(m, b, a); }
+    // 2^n for integral n in [-1022, 1023]
+    static inline Packet pow2n(Packet n)
+    {
+        const __m512d magic = _mm512_set1_pd(6755399441055744.0);
+        __m512i k = _mm512_sub_epi64(_mm512_castpd_si512(_mm512_add_pd(n, magic)),
+                                     _mm512_castpd_si512(magic));
+        k = slli_epi64(_mm512_add_epi64(k, _mm512_set1_epi64(1023)), 52);
+        return _mm512_castsi512_pd(k);
+    }
+    // x = m * 2^e with m in [1, 2), x > 0
+    static inline Packet frexp(Packet x, Packet& e)
+    {
+        const __m512i bits = _mm512_castpd_si512(x);
+        const __m512d two52 = _mm512_set1_pd(4503599627370496.0);
+        e = _mm512_sub_pd(_mm512_castsi512_pd(_mm512_or_si512(srli_epi64(bits, 52),
+                                                              _mm512_castpd_si512(two52))),
+                          _mm512_add_pd(two52, _mm512_set1_pd(1023.0)));
+        return _mm512_castsi512_pd(_mm512_or_si512(
+                                       _mm512_and_si512(bits, _mm512_set1_epi64(0x000FFFFFFFFFFFFFLL)),
+                                       _mm512_set1_epi64(0x3FF0000000000000LL)));
+    }
+};
+
+} // namespace
+
+ClossKernel::Function clossKernelAVX512()
+{
+    return &clossKernel<Avx512Ops>;
+}
+
+#else
+
+ClossKernel::Function clossKernelAVX512()
+{
+    return 0;
+}
+
+#endif
@@ -0,0 +1,196 @@
+#ifndef CLOSSKERNELIMPL_H_
+#define CLOSSKERNELIMPL_H_
+
+#include "ClossKernel.h"
+#include <limits>
+
+/*
+ * Implementation details of ClossKernel.
+ *
+ * The kernel is written once against a small set of packet operations
+ * (load, store, arithmetic, select and two bit manipulation helpers). Each
+ * ClossKernel<ISA>.cpp defines these operations with intrinsics, is compiled
+ * with the matching instruction set flags and instantiates clossKernel().
+ * Everything is kept in an anonymous namespace so that instantiations built
+ * with different flags can never be merged by the linker.
+ */
+
+ClossKernel::Function clossKernelScalar();
+ClossKernel::Function clossKernelSSE2();
+ClossKernel::Function clossKernelAVX2();
+ClossKernel::Function clossKernelAVX512();
+
+namespace
+{
+
+template<typename Ops>
+struct ClossMath
+{
+    typedef typename Ops::Packet Packet;
+    typedef typename Ops::Mask Mask;
+
+    /**
+     * exp(x), relative error below 1e-15 for x in [-708, 709], 0 below.
+     */
+    static inline Packet exp(Packet x)
+    {
+        const Mask underflow = Ops::greater(Ops::set1(-708.0), x);
+        x = Ops::min(Ops::max(x, Ops::set1(-708.0)), Ops::set1(709.0));
+        // x = n * ln(2) + r with |r| <= ln(2) / 2
+        const Packet magic = Ops::set1(6755399441055744.0); // 2^52 + 2^51
+        const Packet n = Ops::sub(Ops::fmadd(x, Ops::set1(1.4426950408889634), magic),
+                                  magic);
+        Packet r = Ops::fmadd(n, Ops::set1(-6.93145751953125e-1), x);
+        r = Ops::fmadd(n, Ops::set1(-1.42860682030941723212e-6), r);
+        // Taylor series of exp(r) up to r^12
+        Packet y = Ops::set1(1.0 / 479001600.0);
+        y = Ops::fmadd(y, r, Ops::set1(1.0 / 39916800.0));
+        y = Ops::fmadd(y, r, Ops::set1(1.0 / 3628800.0));
+        y = Ops::fmadd(y, r, Ops::set1(1.0 / 362880.0));
+        y = Ops::fmadd(y, r, Ops::set1(1.0 / 40320.0));
+        y = Ops::fmadd(y, r, Ops::set1(1.0 / 5040.0));
+        y = Ops::fmadd(y, r, Ops::set1(1.0 / 720.0));
+        y = Ops::fmadd(y, r, Ops::set1(1.0 / 120.0));
+        y = Ops::fmadd(y, r, Ops::set1(1.0 / 24.0));
+        y = Ops::fmadd(y, r, Ops::set1(1.0 / 6.0));
+        y = Ops::fmadd(y, r, Ops::set1(0.5));
+        y = Ops::fmadd(y, r, Ops::set1(1.0));
+        y = Ops::fmadd(y, r, Ops::set1(1.0));
+        return Ops::select(underflow, Ops::set1(0.0), Ops::mul(y, Ops::pow2n(n)));
+    }
+
+    /**
+     * log(x) for finite x > 0.
+     */
+    static inline Packet log(Packet x)
+    {
+        // frexp() expects a normalized x, scale subnormal x by 2^52
+        const Mask subnormal = Ops::greater(Ops::set1(std::numeric_limits<double>::min()), x);
+        x = Ops::select(subnormal, Ops::mul(x, Ops::set1(4503599627370496.0)), x);
+        // x = m * 2^e with m in [sqrt(1/2), sqrt(2))
+        Packet e;
+        Packet m = Ops::frexp(x, e);
+        e = Ops::select(subnormal, Ops::sub(e, Ops::set1(52.0)), e);
+        const Mask big = Ops::greater(m, Ops::set1(1.4142135623730951));
+        m = Ops::select(big, Ops::mul(m, Ops::set1(0.5)), m);
+        e = Ops::select(big, Ops::add(e, Ops::set1(1.0)), e);
+        // log(m) = 2 atanh(s) = 2 (s + s^3 / 3 + s^5 / 5 + ...), |s| < 0.172
+        const Packet f = Ops::sub(m, Ops::set1(1.0));
+        const Packet s = Ops::div(f, Ops::add(f, Ops::set1(2.0)));
+        const Packet s2 = Ops::mul(s, s);
+        Packet y = Ops::set1(1.0 / 21.0);
+        y = Ops::fmadd(y, s2, Ops::set1(1.0 / 19.0));
+        y = Ops::fmadd(y, s2, Ops::set1(1.0 / 17.0));
+        y = Ops::fmadd(y, s2, Ops::set1(1.0 / 15.0));
+        y = Ops::fmadd(y, s2, Ops::set1(1.0 / 13.0));
+        y = Ops::fmadd(y, s2, Ops::set1(1.0 / 11.0));
+        y = Ops::fmadd(y, s2, Ops::set1(1.0 / 9.0));
+        y = Ops::fmadd(y, s2, Ops::set1(1.0 / 7.0));
+        y = Ops::fmadd(y, s2, Ops::set1(1.0 / 5.0));
+        y = Ops::fmadd(y, s2, Ops::set1(1.0 / 3.0));
+        y = Ops::fmadd(y, s2, Ops::set1(1.0));
+        y = Ops::mul(Ops::add(s, s), y);
+        y = Ops::fmadd(e, Ops::set1(1.42860682030941723212e-6), y);
+        return Ops::fmadd(e, Ops::set1(6.93145751953125e-1), y);
+    }
+};
+
+enum ClossMode
+{
+    GENERIC_P,
+    P_ONE,
+    P_TWO
+};
+
+struct ClossConstants
+{
+    double lambda, beta, p, dScale, zeroPow;
+};
+
+template<typename Ops, int Mode>
+inline void clossPacket(const double* x, double* loss, double* derivative,
+                        const ClossConstants& c)
+{
+    typedef typename Ops::Packet Packet;
+    typedef ClossMath<Ops> Math;
+
+    const Packet v = Ops::load(x);
+    const Packet lambda = Ops::set1(c.lambda);
+    Packet rbf, d;
+    if(Mode == P_TWO)
+    {
+        rbf = Math::exp(Ops::mul(lambda, Ops::mul(v, v)));
+        d = Ops::mul(Ops::mul(Ops::set1(c.dScale), rbf), v);
+    }
+    else if(Mode == P_ONE)
+    {
+        rbf = Math::exp(Ops::mul(lambda, Ops::abs(v)));
+        d = Ops::copysign(Ops::mul(Ops::set1(c.dScale), rbf), v);
+    }
+    else
+    {
+        // |x|^(p-1) = exp((p-1) log|x|), |x| = 0 is handled separately
+        const Packet a = Ops::abs(v);
+        const Packet zero = Ops::set1(0.0);
+        const typename Ops::Mask positive = Ops::greater(a, zero);
+        const Packet apm1 = Ops::select(positive,
+                                        Math::exp(Ops::mul(Ops::set1(c.p - 1),
+                                                           Math::log(a))),
+                                        Ops::set1(c.zeroPow));
+        const Packet ap = Ops::select(positive, Ops::mul(a, apm1), zero);
+        rbf = Math::exp(Ops::mul(lambda, ap));
+        d = Ops::copysign(Ops::mul(Ops::mul(Ops::set1(c.dScale), rbf), apm1), v);
+    }
+    Ops::store(loss, Ops::mul(Ops::set1(c.beta), Ops::sub(Ops::set1(1.0), rbf)));
+    if(derivative)
+        Ops::store(derivative, d);
+}
+
+template<typename Ops, int Mode>
+void clossLoop(const double* x, double* loss, double* derivative, int size,
+               const ClossConstants& c)
+{
+    const int width = Ops::size;
+    int i = 0;
+    for(; i + width <= size; i += width)
+        clossPacket<Ops, Mode>(x + i, loss + i, derivative ? derivative + i : 0, c);
+    if(i < size)
+    {
+        // pad the remainder to a full packet
+        double bx[width], bl[width], bd[width];
+        for(int k = 0; k < width; k++)
+            bx[k] = i + k < size ? x[i + k] : 0.0;
+        clossPacket<Ops, Mode>(bx, bl, derivative ? bd : 0, c);
+        for(int k = 0; i + k < size; k++)
+        {
+            loss[i + k] = bl[k];
+            if(derivative)
+                derivative[i + k] = bd[k];
+        }
+    }
+}
+
+template<typename Ops>
+void clossKernel(const double* x, double* loss, double* derivative,
+                 int size, double lambda, double beta, double p)
+{
+    ClossConstants c;
+    c.lambda = lambda;
+    c.beta = beta;
+    c.p = p;
+    c.dScale = -beta * lambda * p;
+    // limit of |x|^(p-1) for x -> 0
+    c.zeroPow = p > 1.0 ? 0.0 :
+                (p == 1.0 ? 1.0 : std::numeric_limits<double>::infinity());
+
+    if(p == 2.0)
+        clossLoop<Ops, P_TWO>(x, loss, derivative, size, c);
+    else if(p == 1.0)
+        clossLoop<Ops, P_ONE>(x, loss, derivative, size, c);
+    else
+        clossLoop<Ops, GENERIC_P>(x, loss, derivative, size, c);
+}
+
+} // namespace
+
+#endif // CLOSSKERNELIMPL_H_
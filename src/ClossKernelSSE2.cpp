@@ -0,0 +1,73 @@
+#include "ClossKernelImpl.h"
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+
+namespace
+{
+
+struct Sse2Ops
+{
+    typedef __m128d Packet;
+    typedef __m128d Mask;
+    enum { size = 2 };
+
+    static inline Packet load(const double* p) { return _mm_loadu_pd(p); }
+    static inline void store(double* p, Packet a) { _mm_storeu_pd(p, a); }
+    static inline Packet set1(double a) { return _mm_set1_pd(a); }
+    static inline Packet add(Packet a, Packet b) { return _mm_add_pd(a, b); }
+    static inline Packet sub(Packet a, Packet b) { return _mm_sub_pd(a, b); }
+    static inline Packet mul(Packet a, Packet b) { return _mm_mul_pd(a, b); }
+    static inline Packet div(Packet a, Packet b) { return _mm_div_pd(a, b); }
+    static inline Packet fmadd(Packet a, Packet b, Packet c) { return _mm_add_pd(_mm_mul_pd(a, b), c); }
+    static inline Packet min(Packet a, Packet b) { return _mm_min_pd(a, b); }
+    static inline Packet max(Packet a, Packet b) { return _mm_max_pd(a, b); }
+    static inline Packet abs(Packet a) { return _mm_andnot_pd(_mm_set1_pd(-0.0), a); }
+    static inline Packet copysign(Packet magnitude, Packet sign)
+    {
+        const __m128d signMask = _mm_set1_pd(-0.0);
+        return _mm_or_pd(_mm_andnot_pd(signMask, magnitude), _mm_and_pd(signMask, sign));
+    }
+    static inline Mask greater(Packet a, Packet b) { return _mm_cmpgt_pd(a, b); }
+    static inline Packet select(Mask m, Packet a, Packet b)
+    {
+        return _mm_or_pd(_mm_and_pd(m, a), _mm_andnot_pd(m, b));
+    }
+    // 2^n for integral n in [-1022, 1023]
+    static inline Packet pow2n(Packet n)
+    {
+        const __m128d magic = _mm_set1_pd(6755399441055744.0);
+        __m128i k = _mm_sub_epi64(_mm_castpd_si128(_mm_add_pd(n, magic)),
+                                  _mm_castpd_si128(magic));
+        k = _mm_slli_epi64(_mm_add_epi64(k, _mm_set1_epi64x(1023)), 52);
+        return _mm_castsi128_pd(k);
+    }
+    // x = m * 2^e with m in [1, 2), x > 0
+    static inline Packet frexp(Packet x, Packet& e)
+    {
+        const __m128i bits = _mm_castpd_si128(x);
+        const __m128d two52 = _mm_set1_pd(4503599627370496.0);
+        e = _mm_sub_pd(_mm_castsi128_pd(_mm_or_si128(_mm_srli_epi64(bits, 52),
+                                                     _mm_castpd_si128(two52))),
+                       _mm_add_pd(two52, _mm_set1_pd(1023.0)));
+        return _mm_castsi128_pd(_mm_or_si128(
+                                    _mm_and_si128(bits, _mm_set1_epi64x(0x000FFFFFFFFFFFFFLL)),
+                                    _mm_set1_epi64x(0x3FF0000000000000LL)));
+    }
+};
+
+} // namespace
+
+ClossKernel::Function clossKernelSSE2()
+{
+    return &clossKernel<Sse2Ops>;
+}
+
+#else
+
+ClossKernel::Function clossKernelSSE2()
+{
+    return 0;
+}
+
+#endif
@@ -4,20 +4,95 @@
 #include <OpenANN/util/OpenANNException.h>
 #include <OpenANN/util/Random.h>
 #include <Eigen/Core>
+#include <algorithm>
+#include <cstring>
 #include <iostream>
+#include <stdint.h>
 
 #include "ClossNet.h"
 #include "BPLayer.h"
+#include "Profiler.h"
 
 using namespace OpenANN;
 
+namespace
+{
+// smaller parts of a batch are not worth a thread
+const int MIN_PATTERNS_PER_THREAD = 64;
+// data sets without matrices are evaluated in blocks of this many examples,
+// they may not fit into memory (see StreamingDataSet)
+const int EVALUATION_BLOCK = 4096;
+
+// binary model format, see ClossNet::BINARY
+const char MODEL_MAGIC[8] = {'C', 'L', 'O', 'S', 'S', 'N', 'E', 'T'};
+const unsigned int MODEL_VERSION = 1;
+const std::size_t MODEL_HEADER_BYTES = 48;
+const std::size_t MODEL_ALIGNMENT = 64;
+
+bool littleEndian()
+{
+    const uint16_t one = 1;
+    return *reinterpret_cast<const unsigned char*>(&one) == 1;
+}
+
+void putBytes(std::ostream& stream, uint64_t value, int bytes)
+{
+    for(int i = 0; i < bytes; i++)
+        stream.put(static_cast<char>((value >> (8 * i)) & 0xff));
+}
+
+uint64_t getBytes(const char* data, int bytes)
+{
+    uint64_t value = 0;
+    for(int i = 0; i < bytes; i++)
+        value |= uint64_t(static_cast<unsigned char>(data[i])) << (8 * i);
+    return value;
+}
+
+void putDouble(std::ostream& stream, double value)
+{
+    uint64_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    putBytes(stream, bits, sizeof(bits));
+}
+
+double getDouble(const char* data)
+{
+    const uint64_t bits = getBytes(data, sizeof(bits));
+    double value;
+    std::memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+/**
+ * Decode little-endian doubles independent of the byte order of the host.
+ */
+void getDoubles(const char* data, std::size_t n, Eigen::VectorXd& values)
+{
+    values.resize(n);
+    if(littleEndian())
+        std::memcpy(values.data(), data, n * sizeof(double));
+    else
+    {
+        for(std::size_t i = 0; i < n; i++)
+            values(i) = getDouble(data + i * sizeof(double));
+    }
+}
+}
+
 /**
  * Create feedforward neural network.
  */
 ClossNet::ClossNet()
     : kernelSize(0.5)
     , pValue(2.0)
+    , singlePrecision(false)
+    , parameterArena(0, 0)
+    , storageInput(0)
+    , storageOutput(0)
+    , matrixSet(0)
 {
+    updateClossConstants();
     errorFunction = NO_E_DEFINED;
     Net::useDropout(false);
 }
@@ -26,23 +101,204 @@ ClossNet& ClossNet::bpLayer(int units, ActivationFunction act, double stdDev, bo
 {
     architecture << "bp_layer " << units << " " << (int) act << " "
                  << stdDev << " " << bias << " ";
-    addLayer(new BPLayer(infos.back(), units, bias, act, stdDev));
+    BPLayer* layer = new BPLayer(infos.back(), units, bias, act, stdDev);
+    layer->setSinglePrecision(singlePrecision);
+    addLayer(layer);
+    // Net only sets P and sizes its buffers in addOutputLayer()
+    initializeNetwork();
+    buildArena();
     return *this;
 }
 
-void ClossNet::save(std::ostream& stream)
+bool ClossNet::hasOnlyBPLayers()
+{
+    if(layers.size() < 2)
+        return false;
+    // the first layer is the input layer and has no parameters
+    for(std::vector<Layer*>::iterator layer = layers.begin() + 1;
+        layer != layers.end(); ++layer)
+    {
+        if(!dynamic_cast<BPLayer*>(*layer))
+            return false;
+    }
+    return true;
+}
+
+bool ClossNet::usesArena()
+{
+    return parameterArena.size() == P && P > 0 && hasOnlyBPLayers();
+}
+
+void ClossNet::buildArena()
+{
+    if(!hasOnlyBPLayers())
+        return;
+
+    int size = 0;
+    for(std::vector<Layer*>::iterator layer = layers.begin() + 1;
+        layer != layers.end(); ++layer)
+        size += static_cast<BPLayer*>(*layer)->dimension();
+    OPENANN_CHECK_EQUALS(size, P);
+
+    // bind to the new storage first, this copies the current values
+    Eigen::VectorXd newParameters(size), newDerivatives(size);
+    bindArena(newParameters.data(), newDerivatives.data(), true);
+    parameterStorage.swap(newParameters);
+    derivativeArena.swap(newDerivatives);
+    mappedModel.reset();
+}
+
+void ClossNet::bindArena(double* parameters, double* derivatives, bool keepValues)
+{
+    int offset = 0;
+    for(std::vector<Layer*>::iterator layer = layers.begin() + 1;
+        layer != layers.end(); ++layer)
+        offset += static_cast<BPLayer*>(*layer)->useStorage(
+                      parameters + offset, derivatives + offset, keepValues);
+    OPENANN_CHECK_EQUALS(offset, P);
+    // placement new is the documented way to change the array of a Map
+    new (&parameterArena) Eigen::Map<Eigen::VectorXd>(parameters, offset);
+
+    // layers register their parameters in storage order
+    for(int p = 0; p < offset; p++)
+    {
+        this->parameters[p] = parameters + p;
+        this->derivatives[p] = derivatives + p;
+    }
+}
+
+const Eigen::VectorXd& ClossNet::currentParameters()
+{
+    if(!usesArena())
+        return Net::currentParameters();
+    parameterVector = parameterArena;
+    return parameterVector;
+}
+
+void ClossNet::setParameters(const Eigen::VectorXd& parameters)
+{
+    if(!usesArena())
+    {
+        Net::setParameters(parameters);
+        return;
+    }
+    parameterArena = parameters;
+    for(std::vector<Layer*>::iterator layer = layers.begin();
+        layer != layers.end(); ++layer)
+        (**layer).updatedParameters();
+}
+
+void ClossNet::save(std::ostream& stream, ModelFormat format)
 {
-    Net::save(stream);
-    stream << "kernelSize " << kernelSize;
-    stream << "pValue" << pValue;
+    if(format == TEXT)
+    {
+        Net::save(stream);
+        stream << "kernelSize " << kernelSize << std::endl;
+        stream << "pValue " << pValue << std::endl;
+        return;
+    }
+
+    const std::string layout = architecture.str();
+    const std::size_t offset = (MODEL_HEADER_BYTES + layout.size() + MODEL_ALIGNMENT - 1)
+                               / MODEL_ALIGNMENT * MODEL_ALIGNMENT;
+    stream.write(MODEL_MAGIC, sizeof(MODEL_MAGIC));
+    putBytes(stream, MODEL_VERSION, 4);
+    putBytes(stream, layout.size(), 4);
+    putBytes(stream, offset, 8);
+    putBytes(stream, P, 8);
+    putDouble(stream, kernelSize);
+    putDouble(stream, pValue);
+    stream.write(layout.data(), layout.size());
+    for(std::size_t i = MODEL_HEADER_BYTES + layout.size(); i < offset; i++)
+        stream.put(0);
+
+    const Eigen::VectorXd& values = currentParameters();
+    if(littleEndian())
+        stream.write(reinterpret_cast<const char*>(values.data()), P * sizeof(double));
+    else
+    {
+        for(int p = 0; p < P; p++)
+            putDouble(stream, values(p));
+    }
+    if(!stream)
+        throw OpenANNException("Could not write model.");
+}
+
+std::pair<std::size_t, std::size_t> ClossNet::loadHeader(const char* header, std::size_t size)
+{
+    if(size < MODEL_HEADER_BYTES
+       || std::memcmp(header, MODEL_MAGIC, sizeof(MODEL_MAGIC)) != 0)
+        throw OpenANNException("Not a binary ClossNet model.");
+    const uint64_t version = getBytes(header + 8, 4);
+    if(version != MODEL_VERSION)
+        throw OpenANNException("Unsupported model version.");
+    const std::size_t layoutSize = getBytes(header + 12, 4);
+    const std::size_t offset = getBytes(header + 16, 8);
+    const std::size_t count = getBytes(header + 24, 8);
+    if(size < MODEL_HEADER_BYTES + layoutSize
+       || offset < MODEL_HEADER_BYTES + layoutSize || offset % sizeof(double) != 0)
+        throw OpenANNException("Corrupted model header.");
+
+    std::istringstream layout(std::string(header + MODEL_HEADER_BYTES, layoutSize));
+    load(layout);
+    setKernelSize(getDouble(header + 32));
+    setPValue(getDouble(header + 40));
+    if(count != (std::size_t) dimension())
+        throw OpenANNException("Number of parameters does not match the architecture.");
+    return std::make_pair(offset, count);
+}
+
+void ClossNet::loadMapped(const std::string& fileName)
+{
+    // the parameters are bound to the mapping and change during training
+    std::unique_ptr<MappedFile> file(new MappedFile(fileName, true));
+    const std::pair<std::size_t, std::size_t> block = loadHeader(file->data(), file->size());
+    if(file->size() < block.first + block.second * sizeof(double))
+        throw OpenANNException("Model file '" + fileName + "' is truncated.");
+
+    char* values = file->data() + block.first;
+    if(littleEndian() && usesArena())
+    {
+        bindArena(reinterpret_cast<double*>(values), derivativeArena.data(), false);
+        parameterStorage.resize(0);
+        mappedModel.swap(file);
+        for(std::vector<Layer*>::iterator layer = layers.begin();
+            layer != layers.end(); ++layer)
+            (**layer).updatedParameters();
+    }
+    else
+    {
+        Eigen::VectorXd parameters;
+        getDoubles(values, block.second, parameters);
+        setParameters(parameters);
+    }
 }
 
 void ClossNet::load(std::istream& stream)
 {
+    if(stream.peek() == MODEL_MAGIC[0])
+    {
+        // binary model, see ClossNet::BINARY
+        std::vector<char> header(MODEL_HEADER_BYTES);
+        if(!stream.read(header.data(), header.size()))
+            throw OpenANNException("Not a binary ClossNet model.");
+        header.resize(MODEL_HEADER_BYTES + getBytes(header.data() + 12, 4));
+        stream.read(header.data() + MODEL_HEADER_BYTES, header.size() - MODEL_HEADER_BYTES);
+        const std::pair<std::size_t, std::size_t> block =
+            loadHeader(header.data(), stream ? header.size() : 0);
+        stream.ignore(block.first - header.size());
+        std::vector<char> values(block.second * sizeof(double));
+        if(!stream.read(values.data(), values.size()))
+            throw OpenANNException("Model is truncated.");
+        Eigen::VectorXd parameters;
+        getDoubles(values.data(), block.second, parameters);
+        setParameters(parameters);
+        return;
+    }
+
     std::string type;
-    while(!stream.eof())
+    while(stream >> type)
     {
-        stream >> type;
         if(type == "input")
         {
             int dim1, dim2, dim3;
@@ -219,7 +475,6 @@ void ClossNet::load(std::istream& stream)
         }
         else if(type == "parameters")
         {
-            double p = 0.0;
             for(int i = 0; i < dimension(); i++)
                 stream >> parameterVector(i);
             setParameters(parameterVector);
@@ -266,6 +521,7 @@ double ClossNet::getKernelSize() const
 ClossNet& ClossNet::setKernelSize(double kernel)
 {
     kernelSize = kernel;
+    updateClossConstants();
     return *this;
 }
 
@@ -277,36 +533,159 @@ double ClossNet::getPValue() const
 ClossNet& ClossNet::setPValue(double value)
 {
     pValue = value;
+    updateClossConstants();
     return *this;
 }
 
+ClossNet& ClossNet::setThreads(int threads)
+{
+    if(threads == 0)
+        threads = WorkerPool::hardwareThreads();
+    if(threads < 0)
+        throw OpenANNException("Number of threads must not be negative.");
+    workers.clear();
+    if(threads == 1)
+        pool.reset();
+    else
+        pool.reset(new WorkerPool(threads));
+    return *this;
+}
+
+int ClossNet::getThreads() const
+{
+    return pool ? pool->threads() : 1;
+}
+
+ClossNet& ClossNet::setSinglePrecision(bool enabled)
+{
+    singlePrecision = enabled;
+    for(std::vector<Layer*>::iterator layer = layers.begin();
+        layer != layers.end(); ++layer)
+    {
+        BPLayer* bpLayer = dynamic_cast<BPLayer*>(*layer);
+        if(bpLayer)
+            bpLayer->setSinglePrecision(enabled);
+    }
+    return *this;
+}
+
+bool ClossNet::getSinglePrecision() const
+{
+    return singlePrecision;
+}
+
+Learner& ClossNet::trainingSet(Eigen::MatrixXd& input, Eigen::MatrixXd& output)
+{
+    Net::trainingSet(input, output);
+    storageInput = &input;
+    storageOutput = &output;
+    matrixSet = 0;
+    return *this;
+}
+
+Learner& ClossNet::trainingSet(DataSet& dataSet)
+{
+    Net::trainingSet(dataSet);
+    storageInput = 0;
+    storageOutput = 0;
+    matrixSet = dynamic_cast<MatrixDataSet*>(&dataSet);
+    return *this;
+}
+
+bool ClossNet::trainingMatrices(Eigen::MatrixXd*& X, Eigen::MatrixXd*& T)
+{
+    if(matrixSet)
+    {
+        // the matrices of a data set may change, e.g. train and test mode
+        X = &matrixSet->inputMatrix();
+        T = &matrixSet->outputMatrix();
+    }
+    else
+    {
+        X = storageInput;
+        T = storageOutput;
+    }
+    return X && T;
+}
+
 double ClossNet::error(unsigned int n)
 {
-    std::vector<int> vec;
-    vec.push_back(n);
-    return error(vec.begin(), vec.end()).mean();
+    return error(n, n + 1).mean();
+}
+
+Eigen::VectorXd ClossNet::error(int startN, int endN, bool computeDerivative)
+{
+    const int nPatterns = endN - startN;
+    Eigen::MatrixXd* X;
+    Eigen::MatrixXd* T;
+    if(trainingMatrices(X, T))
+    {
+        // the input layer passes its input on, so the whole training set can
+        // be propagated without any copy
+        if(startN == 0 && endN == X->rows())
+            return error(X, *T, computeDerivative);
+        tempInput = X->middleRows(startN, nPatterns);
+        return error(&tempInput, T->middleRows(startN, nPatterns), computeDerivative);
+    }
+
+    tempInput.conservativeResize(nPatterns, trainSet->inputs());
+    tempTarget.conservativeResize(nPatterns, trainSet->outputs());
+    for(int n = 0; n < nPatterns; n++)
+    {
+        tempInput.row(n) = trainSet->getInstance(startN + n);
+        tempTarget.row(n) = trainSet->getTarget(startN + n);
+    }
+    return error(&tempInput, tempTarget, computeDerivative);
 }
 
 Eigen::VectorXd ClossNet::error(std::vector<int>::const_iterator startN,
-                                std::vector<int>::const_iterator endN)
+                                std::vector<int>::const_iterator endN,
+                                bool computeDerivative)
 {
     const int nPatterns = endN - startN;
+    bool contiguous = true;
+    for(std::vector<int>::const_iterator it = startN; it != endN && contiguous; ++it)
+        contiguous = *it == *startN + (it - startN);
+    if(contiguous && nPatterns > 0)
+        return error(*startN, *startN + nPatterns, computeDerivative);
+
+    Eigen::MatrixXd* X;
+    Eigen::MatrixXd* T;
+    const bool direct = trainingMatrices(X, T);
     tempInput.conservativeResize(nPatterns, trainSet->inputs());
-    Eigen::MatrixXd T(nPatterns, trainSet->outputs());
+    tempTarget.conservativeResize(nPatterns, trainSet->outputs());
     int n = 0;
     for(std::vector<int>::const_iterator it = startN; it != endN; ++it, ++n)
     {
-        tempInput.row(n) = trainSet->getInstance(*it);
-        T.row(n) = trainSet->getTarget(*it);
+        if(direct)
+        {
+            tempInput.row(n) = X->row(*it);
+            tempTarget.row(n) = T->row(*it);
+        }
+        else
+        {
+            tempInput.row(n) = trainSet->getInstance(*it);
+            tempTarget.row(n) = trainSet->getTarget(*it);
+        }
     }
-    forwardPropagate(nullptr);
+    return error(&tempInput, tempTarget, computeDerivative);
+}
+
+Eigen::VectorXd ClossNet::error(Eigen::MatrixXd* X,
+                                const Eigen::Ref<const Eigen::MatrixXd>& T,
+                                bool computeDerivative)
+{
+    forwardPropagate(X, nullptr);
     tempError = tempOutput - T;
-    return clossFunction(tempError).rowwise().sum();
+    closs(tempError, tempLoss, computeDerivative ? &tempDelta : nullptr);
+    return tempLoss.rowwise().sum();
 }
 
-void ClossNet::forwardPropagate(double *error)
+void ClossNet::forwardPropagate(Eigen::MatrixXd* x, double *error)
 {
-    Eigen::MatrixXd* y = &tempInput;
+    CLOSS_PROFILE_SCOPE("forward");
+    CLOSS_PROFILE_COUNT("examples forwarded", x->rows());
+    Eigen::MatrixXd* y = x;
     for(std::vector<Layer*>::iterator layer = layers.begin();
         layer != layers.end(); ++layer)
       (**layer).forwardPropagate(y, y, dropout, error);
@@ -318,10 +697,111 @@ void ClossNet::forwardPropagate(double *error)
 
 double ClossNet::error()
 {
-    std::vector<int> vec;
-    for(int n = 0; n < N; n++)
-        vec.push_back(n);
-    return error(vec.begin(), vec.end()).mean();
+    Eigen::VectorXd values;
+    errors(values);
+    return values.mean();
+}
+
+bool ClossNet::providesJacobian()
+{
+    return hasOnlyBPLayers();
+}
+
+void ClossNet::errors(Eigen::VectorXd& values)
+{
+    Eigen::MatrixXd* X;
+    Eigen::MatrixXd* T;
+    if(trainingMatrices(X, T))
+    {
+        values = error(0, N);
+        return;
+    }
+    values.resize(N);
+    for(int start = 0; start < N; start += EVALUATION_BLOCK)
+    {
+        const int end = std::min(start + EVALUATION_BLOCK, N);
+        values.segment(start, end - start) = error(start, end);
+    }
+}
+
+void ClossNet::reserveWorkspaces(int count)
+{
+    if((int) workers.size() < count)
+        workers.resize(count);
+}
+
+void ClossNet::errorJacobian(int workspace, int startN, int endN,
+                             double* values, double* const* rows)
+{
+    OPENANN_CHECK(providesJacobian());
+    OPENANN_CHECK_WITHIN(workspace, 0, (int) workers.size() - 1);
+    const int nPatterns = endN - startN;
+    Worker& worker = workers[workspace];
+    Eigen::MatrixXd* X;
+    Eigen::MatrixXd* T;
+    if(trainingMatrices(X, T))
+    {
+        worker.input = X->middleRows(startN, nPatterns);
+        worker.target = T->middleRows(startN, nPatterns);
+    }
+    else
+    {
+        CLOSS_PROFILE_SCOPE("gather");
+        std::lock_guard<std::mutex> lock(gatherMutex);
+        worker.input.resize(nPatterns, trainSet->inputs());
+        worker.target.resize(nPatterns, trainSet->outputs());
+        for(int n = 0; n < nPatterns; n++)
+        {
+            worker.input.row(n) = trainSet->getInstance(startN + n);
+            worker.target.row(n) = trainSet->getTarget(startN + n);
+        }
+    }
+
+    propagate(worker, rows != 0);
+    Eigen::Map<Eigen::VectorXd>(values, nPatterns) = worker.loss.rowwise().sum();
+    if(!rows)
+        return;
+
+    backpropagate(worker, 0);
+    CLOSS_PROFILE_SCOPE("jacobian");
+    int offset = 0;
+    for(size_t l = 1; l < layers.size(); l++)
+        offset += static_cast<BPLayer*>(layers[l])->jacobian(worker.layers[l - 1],
+                                                              rows, offset);
+    OPENANN_CHECK_EQUALS(offset, P);
+}
+
+void ClossNet::predict(int workspace, const Eigen::MatrixXd& X, Eigen::MatrixXd& Y)
+{
+    OPENANN_CHECK(providesJacobian());
+    OPENANN_CHECK_WITHIN(workspace, 0, (int) workers.size() - 1);
+    Worker& worker = workers[workspace];
+    if(singlePrecision)
+    {
+        worker.singleInput = X.cast<float>();
+        Y = forwardPropagate(worker, worker.singleInput).cast<double>();
+    }
+    else
+    {
+        Y = forwardPropagate(worker, X);
+    }
+    if(errorFunction == CE)
+        OpenANN::softmax(Y);
+}
+
+void ClossNet::predict(int workspace, const Eigen::MatrixXf& X, Eigen::MatrixXf& Y)
+{
+    OPENANN_CHECK(providesJacobian());
+    OPENANN_CHECK_WITHIN(workspace, 0, (int) workers.size() - 1);
+    Worker& worker = workers[workspace];
+    if(!singlePrecision || errorFunction == CE)
+    {
+        worker.input = X.cast<double>();
+        predict(workspace, worker.input, worker.error);
+        Y = worker.error.cast<float>();
+        return;
+    }
+    Y = forwardPropagate(worker, X);
 }
 
 bool ClossNet::providesGradient()
@@ -334,17 +814,193 @@ void ClossNet::errorGradient(std::vector<int>::const_iterator startN,
                              double& value, Eigen::VectorXd& grad)
 {
     int nPatterns = endN - startN;
-    value = error(startN, endN).mean();
+    if(usesArena() &&
+       (singlePrecision || (pool && nPatterns >= 2 * MIN_PATTERNS_PER_THREAD)))
+    {
+        parallelErrorGradient(startN, endN, value, grad);
+        return;
+    }
+    value = error(startN, endN, true).mean();
 
     backpropagate();
+    if(usesArena())
+    {
+        grad = derivativeArena / nPatterns;
+        return;
+    }
     for(int p = 0; p < P; p++)
         grad(p) = *derivatives[p];
     grad /= nPatterns;
 }
 
+void ClossNet::parallelErrorGradient(std::vector<int>::const_iterator startN,
+                                     std::vector<int>::const_iterator endN,
+                                     double& value, Eigen::VectorXd& grad)
+{
+    const int nPatterns = endN - startN;
+    const int nTasks = pool ? std::max(1, std::min(pool->threads(),
+                                                   nPatterns / MIN_PATTERNS_PER_THREAD)) : 1;
+    reserveWorkspaces(nTasks);
+
+    // DataSet::getInstance() is not thread-safe, so other data sets are
+    // gathered before the parallel part
+    Eigen::MatrixXd* X;
+    Eigen::MatrixXd* T;
+    const bool direct = trainingMatrices(X, T);
+    if(!direct)
+    {
+        CLOSS_PROFILE_SCOPE("gather");
+        tempInput.conservativeResize(nPatterns, trainSet->inputs());
+        tempTarget.conservativeResize(nPatterns, trainSet->outputs());
+        int n = 0;
+        for(std::vector<int>::const_iterator it = startN; it != endN; ++it, ++n)
+        {
+            tempInput.row(n) = trainSet->getInstance(*it);
+            tempTarget.row(n) = trainSet->getTarget(*it);
+        }
+    }
+
+    std::function<void(int)> task = [&](int t)
+    {
+        const int begin = (long) nPatterns * t / nTasks;
+        const int end = (long) nPatterns * (t + 1) / nTasks;
+        Worker& worker = workers[t];
+        if(direct)
+        {
+            CLOSS_PROFILE_SCOPE("gather");
+            worker.input.resize(end - begin, X->cols());
+            worker.target.resize(end - begin, T->cols());
+            for(int n = begin; n < end; n++)
+            {
+                worker.input.row(n - begin) = X->row(startN[n]);
+                worker.target.row(n - begin) = T->row(startN[n]);
+            }
+        }
+        else
+        {
+            worker.input = tempInput.middleRows(begin, end - begin);
+            worker.target = tempTarget.middleRows(begin, end - begin);
+        }
+        propagate(worker, true, singlePrecision);
+        worker.value = worker.loss.sum();
+        worker.gradient.resize(P);
+        backpropagate(worker, worker.gradient.data(), singlePrecision);
+    };
+    if(nTasks > 1)
+        pool->run(nTasks, task);
+    else
+        task(0);
+
+    CLOSS_PROFILE_SCOPE("gradient sum");
+    value = 0.0;
+    grad = workers[0].gradient;
+    for(int t = 0; t < nTasks; t++)
+    {
+        value += workers[t].value;
+        if(t > 0)
+            grad += workers[t].gradient;
+    }
+    value /= nPatterns;
+    grad /= nPatterns;
+}
+
+const Eigen::MatrixXd& ClossNet::forwardPropagate(Worker& worker, const Eigen::MatrixXd& x)
+{
+    // the first layer is the input layer, it passes its input on
+    CLOSS_PROFILE_COUNT("examples forwarded", x.rows());
+    worker.layers.resize(layers.size() - 1);
+    const Eigen::MatrixXd* y = &x;
+    for(size_t l = 1; l < layers.size(); l++)
+    {
+        CLOSS_PROFILE_SCOPE_INDEXED("forward layer", l);
+        BPLayer::Workspace& ws = worker.layers[l - 1];
+        static_cast<BPLayer*>(layers[l])->forwardPropagate(*y, ws);
+        y = &ws.output;
+    }
+    return *y;
+}
+
+const Eigen::MatrixXf& ClossNet::forwardPropagate(Worker& worker, const Eigen::MatrixXf& x)
+{
+    CLOSS_PROFILE_COUNT("examples forwarded", x.rows());
+    worker.singleLayers.resize(layers.size() - 1);
+    const Eigen::MatrixXf* y = &x;
+    for(size_t l = 1; l < layers.size(); l++)
+    {
+        CLOSS_PROFILE_SCOPE_INDEXED("forward layer", l);
+        BPLayer::WorkspaceF& ws = worker.singleLayers[l - 1];
+        static_cast<BPLayer*>(layers[l])->forwardPropagate(*y, ws);
+        y = &ws.output;
+    }
+    return *y;
+}
+
+void ClossNet::propagate(Worker& worker, bool computeDerivative, bool single)
+{
+    if(single)
+    {
+        worker.singleInput = worker.input.cast<float>();
+        worker.error = forwardPropagate(worker, worker.singleInput).cast<double>() - worker.target;
+    }
+    else
+    {
+        worker.error = forwardPropagate(worker, worker.input) - worker.target;
+    }
+    CLOSS_PROFILE_SCOPE("closs kernel");
+    worker.loss.resize(worker.error.rows(), worker.error.cols());
+    if(computeDerivative)
+        worker.delta.resize(worker.error.rows(), worker.error.cols());
+    kernel(worker.error.data(), worker.loss.data(),
+           computeDerivative ? worker.delta.data() : 0,
+           worker.error.size(), lambda, beta, pValue);
+    if(single && computeDerivative)
+        worker.singleDelta = worker.delta.cast<float>();
+}
+
+void ClossNet::backpropagate(Worker& worker, double* gradient, bool single)
+{
+    if(single)
+    {
+        if(gradient)
+            worker.singleGradient.resize(P);
+        const Eigen::MatrixXf* delta = &worker.singleDelta;
+        int offset = P;
+        for(size_t l = layers.size() - 1; l > 0; l--)
+        {
+            CLOSS_PROFILE_SCOPE_INDEXED("backward layer", l);
+            BPLayer* layer = static_cast<BPLayer*>(layers[l]);
+            BPLayer::WorkspaceF& ws = worker.singleLayers[l - 1];
+            offset -= layer->dimension();
+            layer->backpropagate(*delta, ws,
+                                 gradient ? worker.singleGradient.data() + offset : 0, l > 1);
+            delta = &ws.prevDelta;
+        }
+        OPENANN_CHECK_EQUALS(offset, 0);
+        if(gradient)
+            Eigen::Map<Eigen::VectorXd>(gradient, P) = worker.singleGradient.cast<double>();
+        return;
+    }
+
+    // layers are stored in the same order as their parameters
+    const Eigen::MatrixXd* delta = &worker.delta;
+    int offset = P;
+    for(size_t l = layers.size() - 1; l > 0; l--)
+    {
+        CLOSS_PROFILE_SCOPE_INDEXED("backward layer", l);
+        BPLayer* layer = static_cast<BPLayer*>(layers[l]);
+        BPLayer::Workspace& ws = worker.layers[l - 1];
+        offset -= layer->dimension();
+        // dE/dX is not required in the first hidden layer
+        layer->backpropagate(*delta, ws, gradient ? gradient + offset : 0, l > 1);
+        delta = &ws.prevDelta;
+    }
+    OPENANN_CHECK_EQUALS(offset, 0);
+}
+
 void ClossNet::finishedIteration()
 {
     Net::finishedIteration();
+    CLOSS_PROFILE_ITERATION();
     if (false) {
         OPENANN_DEBUG << "Current Parameter";
         std::ostringstream oss;
@@ -355,9 +1011,9 @@ void ClossNet::finishedIteration()
 
 void ClossNet::backpropagate()
 {
+    CLOSS_PROFILE_SCOPE("backward");
     // initial delta is derivation of error function
-    Eigen::MatrixXd delta = clossDerivative(tempError);
-    Eigen::MatrixXd *pDelta = &delta;
+    Eigen::MatrixXd *pDelta = &tempDelta;
     int l = L;
     for(std::vector<Layer*>::reverse_iterator layer = layers.rbegin();
             layer != layers.rend(); ++layer, --l)
@@ -368,35 +1024,19 @@ void ClossNet::backpropagate()
     }
 }
 
-template<typename Derived>
-Eigen::MatrixXd ClossNet::clossFunction(const Eigen::MatrixBase<Derived> &YmT)
+void ClossNet::updateClossConstants()
 {
-    double lambda = -1 / (2 * kernelSize * kernelSize);
-    double beta = 1 / (1 - exp(lambda));
-    Eigen::MatrixXd rbf = (YmT.array().abs().pow(pValue) * lambda).exp();
-
-    auto err = (beta * (1 - rbf.array())).eval();
-    return err;
+    lambda = -1 / (2 * kernelSize * kernelSize);
+    beta = 1 / (1 - exp(lambda));
 }
 
-template<typename Derived>
-Eigen::MatrixXd ClossNet::clossDerivative(const Eigen::MatrixBase<Derived>& x)
+void ClossNet::closs(const Eigen::MatrixXd& e, Eigen::MatrixXd& loss,
+                     Eigen::MatrixXd* derivative)
 {
-    double lambda = -1 / (2 * kernelSize * kernelSize);
-    double beta = 1 / (1 - exp(lambda));
-    Eigen::MatrixXd rbf = (x.array().abs().pow(pValue) * lambda).exp();
-
-    auto sign = [](double x) {
-        return x >= 0 ? 1 : -1;
-    };
-    auto signx = x.unaryExpr(sign).array().eval();
-
-    auto d = beta
-             * (-lambda)
-             * pValue
-             * rbf.array()
-             * x.array().abs().pow(pValue -1)
-             * signx;
-
-    return d.eval();
+    CLOSS_PROFILE_SCOPE("closs kernel");
+    loss.resize(e.rows(), e.cols());
+    if(derivative)
+        derivative->resize(e.rows(), e.cols());
+    kernel(e.data(), loss.data(), derivative ? derivative->data() : 0, e.size(),
+           lambda, beta, pValue);
 }
@@ -3,6 +3,16 @@
 
 #include <OpenANN/Net.h>
 #include <Eigen/Core>
+#include "BatchOptimizable.h"
+#include "ClossKernel.h"
+#include "MatrixDataSet.h"
+#include "BPLayer.h"
+#include "MappedFile.h"
+#include "WorkerPool.h"
+#include <memory>
+#include <mutex>
+#include <string>
+#include <utility>
 #include <vector>
 #include <sstream>
 
@@ -13,13 +23,63 @@ using OpenANN::ActivationFunction;
  * Feedforward multilayer neural network using Closs error function.
  *
  * You can specify many different types of layers and choose the architecture
- * almost arbitrary.
+ * almost arbitrary. If all layers after the input layer are BPLayers, the
+ * residuals and Jacobian rows of blocks of training examples can be computed
+ * in one pass (see BatchOptimizable). In that case all parameters and derivatives
+ * are also kept in one contiguous vector each, so that getting or setting the
+ * parameters and collecting the gradient do not go through one pointer per
+ * parameter.
+ *
+ * The forward and backward passes of such a network can run in single
+ * precision, see setSinglePrecision().
  */
-class ClossNet : public OpenANN::Net
+class ClossNet : public OpenANN::Net, public BatchOptimizable
 {
 protected:
     double kernelSize;
     double pValue;
+    // constants of the Closs function, updated with kernelSize and pValue
+    double lambda;
+    double beta;
+    // vectorized implementation chosen for this CPU
+    ClossKernel kernel;
+    // float forward and backward passes, see setSinglePrecision()
+    bool singlePrecision;
+    // Closs of each output and its derivative w.r.t. the error
+    Eigen::MatrixXd tempLoss;
+    Eigen::MatrixXd tempDelta;
+    // targets of gathered mini-batches
+    Eigen::MatrixXd tempTarget;
+    // parameters and derivatives of all BPLayers, see usesArena()
+    Eigen::Map<Eigen::VectorXd> parameterArena;
+    Eigen::VectorXd derivativeArena;
+    // storage of parameterArena, empty if it points into mappedModel
+    Eigen::VectorXd parameterStorage;
+    std::unique_ptr<MappedFile> mappedModel;
+    // training set stored in matrices, see trainingMatrices()
+    Eigen::MatrixXd* storageInput;
+    Eigen::MatrixXd* storageOutput;
+    MatrixDataSet* matrixSet;
+
+    /**
+     * Scratch memory of one thread of the data-parallel gradient or Jacobian.
+     */
+    struct Worker
+    {
+        std::vector<BPLayer::Workspace> layers;
+        Eigen::MatrixXd input, target, error, loss, delta;
+        Eigen::VectorXd gradient;
+        double value;
+        // single precision passes, the Closs is computed in double
+        std::vector<BPLayer::WorkspaceF> singleLayers;
+        Eigen::MatrixXf singleInput, singleDelta;
+        Eigen::VectorXf singleGradient;
+    };
+    // threads of the data-parallel gradient, null if disabled
+    std::unique_ptr<WorkerPool> pool;
+    std::vector<Worker> workers;
+    // DataSet::getInstance() is not thread-safe
+    std::mutex gatherMutex;
 
 public:
     /**
@@ -48,13 +108,29 @@ public:
      * @name Persistence
      */
     ///@{
+    enum ModelFormat
+    {
+        /**
+         * Human readable, for debugging.
+         */
+        TEXT,
+        /**
+         * Versioned little-endian format that can be loaded with
+         * loadMapped(). A header (magic "CLOSSNET", version, size of the
+         * architecture, offset and number of parameters, kernel size and p
+         * value) is followed by the architecture in text form and by the
+         * parameters as doubles at a 64 byte aligned offset.
+         */
+        BINARY
+    };
     /**
      * Save network.
-     * @param stream output stream
+     * @param stream output stream, must be opened in binary mode for BINARY
+     * @param format file format
      */
-    void save(std::ostream& stream);
+    void save(std::ostream& stream, ModelFormat format = TEXT);
     /**
-     * Load network from stream.
+     * Load network from stream, the format is detected automatically.
      *
      * @note Note that we cannot ensure that the network will be reconstructed
      *       correctly in case it contains either an extreme layer, compressed
@@ -75,6 +151,17 @@ public:
      * @param stream input stream
      */
     void load(std::istream& stream);
+    /**
+     * Load network saved in BINARY format without copying the parameters.
+     *
+     * The file is mapped into memory and the layers use the parameters in
+     * the mapping directly if all layers after the input layer are BPLayers
+     * and the machine is little-endian, otherwise they are copied. Changed
+     * parameters are never written back to the file.
+     *
+     * @param fileName name of the model file
+     */
+    void loadMapped(const std::string& fileName);
     ///@}
 
     /**
@@ -124,12 +211,49 @@ public:
      * @return this for chaining
      */
     ClossNet& setPValue(double value);
+    /**
+     * Set number of threads used to compute the gradient.
+     *
+     * If all layers after the input layer are BPLayers, large batches are
+     * split into one part per thread and the gradients of the parts are
+     * summed. Smaller batches and other architectures use one thread.
+     *
+     * @param threads 1 disables parallel computation, 0 uses one thread per
+     *                hardware thread
+     * @return this for chaining
+     */
+    ClossNet& setThreads(int threads);
+    /**
+     * @return number of threads used to compute the gradient
+     */
+    int getThreads() const;
+    /**
+     * Compute predictions and gradients in single precision.
+     *
+     * If all layers after the input layer are BPLayers, predict() and
+     * errorGradient() propagate floats through the layers, which halves
+     * the memory traffic and doubles the SIMD width. Parameters, gradients
+     * and the Closs stay double. Residuals and the Jacobian for LMA
+     * (errors(), errorJacobian()) are always computed in double precision.
+     *
+     * @param enabled use floats
+     * @return this for chaining
+     */
+    ClossNet& setSinglePrecision(bool enabled = true);
+    /**
+     * @return true if predict() and errorGradient() use floats
+     */
+    bool getSinglePrecision() const;
     ///@}
 
     /**
      * @name Inherited Functions
      */
     ///@{
+    virtual OpenANN::Learner& trainingSet(Eigen::MatrixXd& input, Eigen::MatrixXd& output);
+    virtual OpenANN::Learner& trainingSet(OpenANN::DataSet& dataSet);
+    virtual const Eigen::VectorXd& currentParameters();
+    virtual void setParameters(const Eigen::VectorXd& parameters);
     virtual double error(unsigned int n);
     virtual double error();
     virtual bool providesGradient();
@@ -139,16 +263,112 @@ public:
     virtual void finishedIteration();
     ///@}
 
+    /**
+     * @name Batch Evaluation
+     */
+    ///@{
+    virtual bool providesJacobian();
+    virtual void errors(Eigen::VectorXd& values);
+    virtual void reserveWorkspaces(int count);
+    virtual void errorJacobian(int workspace, int startN, int endN,
+                               double* values, double* const* rows);
+    /**
+     * Batched prediction that does not modify the network.
+     *
+     * Calls with different workspaces can run in parallel. Requires
+     * providesJacobian() like errorJacobian().
+     * @param workspace index below the count passed to reserveWorkspaces()
+     * @param X each row is an input
+     * @param Y receives one row of outputs per input
+     */
+    void predict(int workspace, const Eigen::MatrixXd& X, Eigen::MatrixXd& Y);
+    /**
+     * Same as predict() with float inputs and outputs, the layers use
+     * single precision only if it is enabled.
+     */
+    void predict(int workspace, const Eigen::MatrixXf& X, Eigen::MatrixXf& Y);
+    ///@}
+
 protected:
+    bool hasOnlyBPLayers();
+    /**
+     * Check if parameters and derivatives are stored in the arenas.
+     */
+    bool usesArena();
+    /**
+     * Move the parameters of all layers to parameterArena and derivativeArena.
+     */
+    void buildArena();
+    /**
+     * Point all layers, parameterArena and the parameter pointers to storage.
+     * @param keepValues copy the current parameters to the new storage
+     */
+    void bindArena(double* parameters, double* derivatives, bool keepValues);
+    /**
+     * Read the BINARY format after the magic.
+     * @param header all bytes of the header including the magic
+     * @return offset and number of parameters
+     */
+    std::pair<std::size_t, std::size_t> loadHeader(const char* header, std::size_t size);
     void backpropagate();
-    void forwardPropagate(double *error);
+    void forwardPropagate(Eigen::MatrixXd* x, double *error);
+    /**
+     * Get the matrices of the training set if it is stored in matrices.
+     * @return false if the training set is only available row by row
+     */
+    bool trainingMatrices(Eigen::MatrixXd*& X, Eigen::MatrixXd*& T);
+    /**
+     * Compute the Closs of the training examples [startN, endN).
+     *
+     * Forward propagates directly on the training set storage if possible.
+     */
+    Eigen::VectorXd error(int startN, int endN, bool computeDerivative = false);
     Eigen::VectorXd error(std::vector<int>::const_iterator startN,
-                          std::vector<int>::const_iterator endN);
+                          std::vector<int>::const_iterator endN,
+                          bool computeDerivative = false);
+    Eigen::VectorXd error(Eigen::MatrixXd* X, const Eigen::Ref<const Eigen::MatrixXd>& T,
+                          bool computeDerivative);
 
-    template<typename Derived>
-    Eigen::MatrixXd clossFunction(const Eigen::MatrixBase<Derived>& ymt);
-    template<typename Derived>
-    Eigen::MatrixXd clossDerivative(const Eigen::MatrixBase<Derived>& x);
+    /**
+     * Compute the gradient of a batch with the workers, in parallel (see
+     * setThreads()) and in single precision (see setSinglePrecision()).
+     */
+    void parallelErrorGradient(std::vector<int>::const_iterator startN,
+                               std::vector<int>::const_iterator endN,
+                               double& value, Eigen::VectorXd& grad);
+    /**
+     * Forward pass through the BPLayers without modifying them.
+     * @return output of the last layer, stored in worker
+     */
+    const Eigen::MatrixXd& forwardPropagate(Worker& worker, const Eigen::MatrixXd& x);
+    /**
+     * Single precision forward pass, requires setSinglePrecision().
+     */
+    const Eigen::MatrixXf& forwardPropagate(Worker& worker, const Eigen::MatrixXf& x);
+    /**
+     * Forward pass and Closs of one part of a batch.
+     * @param worker scratch memory, input and target must be set
+     * @param computeDerivative compute the derivative of the Closs
+     * @param single propagate in single precision
+     */
+    void propagate(Worker& worker, bool computeDerivative, bool single = false);
+    /**
+     * Backward pass of one part of a batch after propagate().
+     * @param worker scratch memory
+     * @param gradient receives the summed gradient, may be null
+     * @param single same as in propagate()
+     */
+    void backpropagate(Worker& worker, double* gradient, bool single = false);
+
+    void updateClossConstants();
+    /**
+     * Compute Closs function and optionally its derivative in one pass.
+     * @param e errors, i.e. output minus target
+     * @param loss Closs of each element of e
+     * @param derivative derivative of each element of loss, may be null
+     */
+    void closs(const Eigen::MatrixXd& e, Eigen::MatrixXd& loss,
+               Eigen::MatrixXd* derivative);
 };
 
 
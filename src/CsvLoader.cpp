@@ -0,0 +1,253 @@
+#include "CsvLoader.h"
+#include <OpenANN/util/OpenANNException.h>
+#include <algorithm>
+#include <cstring>
+#include <limits>
+#include <locale>
+#include <sstream>
+#include <stdint.h>
+
+using OpenANN::OpenANNException;
+
+namespace
+{
+// ranges are about this large, small enough to balance the threads
+const std::size_t RANGE_BYTES = 4 * 1024 * 1024;
+
+// powers of ten that are exact doubles
+const double EXACT_POWERS[] =
+{
+    1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+    1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
+
+inline bool isBlank(char c)
+{
+    return c == ' ' || c == '\t' || c == '\r';
+}
+
+inline bool isDigit(char c)
+{
+    return c >= '0' && c <= '9';
+}
+
+const char* lineEnd(const char* p, const char* end)
+{
+    const void* newline = std::memchr(p, '\n', end - p);
+    return newline ? static_cast<const char*>(newline) : end;
+}
+
+bool isEmptyLine(const char* p, const char* end)
+{
+    while(p != end && isBlank(*p))
+        p++;
+    return p == end;
+}
+
+int countRows(const char* p, const char* end)
+{
+    int rows = 0;
+    while(p != end)
+    {
+        const char* eol = lineEnd(p, end);
+        if(!isEmptyLine(p, eol))
+            rows++;
+        p = eol == end ? end : eol + 1;
+    }
+    return rows;
+}
+
+/**
+ * Slow path of parseDouble() for the number [begin, end), correctly rounded.
+ */
+bool parseDoubleExact(const char* begin, const char* end, double& value)
+{
+    std::istringstream stream(std::string(begin, end));
+    stream.imbue(std::locale::classic());
+    return bool(stream >> value);
+}
+}
+
+CsvLoader::CsvLoader(int threads)
+    : pool(new WorkerPool(threads)), nRows(0)
+{
+}
+
+CsvLoader::~CsvLoader()
+{
+}
+
+int CsvLoader::rows() const
+{
+    return nRows;
+}
+
+const char* CsvLoader::parseDouble(const char* begin, const char* end, double& value)
+{
+    const char* p = begin;
+    const bool negative = p != end && *p == '-';
+    if(p != end && (*p == '-' || *p == '+'))
+        p++;
+
+    uint64_t mantissa = 0;
+    int digits = 0, exponent = 0;
+    bool anyDigit = false;
+    for(; p != end && isDigit(*p); p++, anyDigit = true)
+    {
+        if(digits < 19)
+        {
+            if(mantissa || *p != '0')
+                digits++;
+            mantissa = mantissa * 10 + (*p - '0');
+        }
+        else
+            exponent++;
+    }
+    if(p != end && *p == '.')
+    {
+        for(p++; p != end && isDigit(*p); p++, anyDigit = true)
+        {
+            if(digits < 19)
+            {
+                if(mantissa || *p != '0')
+                    digits++;
+                mantissa = mantissa * 10 + (*p - '0');
+                exponent--;
+            }
+        }
+    }
+    if(!anyDigit)
+        return begin;
+    if(p != end && (*p == 'e' || *p == 'E'))
+    {
+        const char* q = p + 1;
+        const bool negativeExponent = q != end && *q == '-';
+        if(q != end && (*q == '-' || *q == '+'))
+            q++;
+        if(q != end && isDigit(*q))
+        {
+            int e = 0;
+            for(; q != end && isDigit(*q); q++)
+                e = std::min(e * 10 + (*q - '0'), 100000);
+            exponent += negativeExponent ? -e : e;
+            p = q;
+        }
+    }
+
+    // Clinger's fast path: mantissa and power of ten are exact doubles
+    if(digits == 19 || mantissa > (uint64_t(1) << 53) || exponent < -22 || exponent > 22)
+        return parseDoubleExact(begin, p, value) ? p : begin;
+    const double m = static_cast<double>(mantissa);
+    value = exponent < 0 ? m / EXACT_POWERS[-exponent] : m * EXACT_POWERS[exponent];
+    if(negative)
+        value = -value;
+    return p;
+}
+
+int CsvLoader::open(const std::string& fileName)
+{
+    file.reset(new MappedFile(fileName));
+    ranges.clear();
+    nRows = 0;
+    const char* begin = file->data();
+    const char* end = begin + file->size();
+
+    // skip empty lines and a header, data rows start with a number
+    while(begin != end)
+    {
+        const char* eol = lineEnd(begin, end);
+        const char* p = begin;
+        while(p != eol && isBlank(*p))
+            p++;
+        double value;
+        if(p != eol && parseDouble(p, eol, value) != p)
+            break;
+        const bool header = p != eol;
+        begin = eol == end ? end : eol + 1;
+        if(header)
+            break;
+    }
+
+    // split at the line boundaries after multiples of RANGE_BYTES
+    for(const char* start = begin; start != end;)
+    {
+        const char* stop = end;
+        if(std::size_t(end - start) > RANGE_BYTES)
+        {
+            stop = lineEnd(start + RANGE_BYTES, end);
+            if(stop != end)
+                stop++;
+        }
+        Range range = {start, stop, 0, 0};
+        ranges.push_back(range);
+        start = stop;
+    }
+
+    pool->run(ranges.size(), [this](int r)
+    {
+        ranges[r].rows = countRows(ranges[r].begin, ranges[r].end);
+    });
+    for(std::size_t r = 0; r < ranges.size(); r++)
+    {
+        ranges[r].firstRow = nRows;
+        nRows += ranges[r].rows;
+    }
+    return nRows;
+}
+
+void CsvLoader::read(int startRow, int endRow, Eigen::MatrixXd& input, Eigen::MatrixXd& output)
+{
+    if(startRow < 0 || endRow > nRows || startRow > endRow)
+        throw OpenANNException("Invalid CSV row range.");
+    if(input.rows() != endRow - startRow || output.rows() != endRow - startRow)
+        throw OpenANNException("Matrices do not match the CSV row range.");
+    const int nInput = input.cols();
+    const int nColumn = nInput + output.cols();
+
+    pool->run(ranges.size(), [&](int r)
+    {
+        const Range& range = ranges[r];
+        if(range.firstRow >= endRow || range.firstRow + range.rows <= startRow)
+            return;
+        int row = range.firstRow;
+        for(const char* p = range.begin; p != range.end && row < endRow;)
+        {
+            const char* eol = lineEnd(p, range.end);
+            if(isEmptyLine(p, eol))
+            {
+                p = eol == range.end ? eol : eol + 1;
+                continue;
+            }
+            if(row >= startRow)
+            {
+                const int i = row - startRow;
+                for(int c = 0; c < nColumn; c++)
+                {
+                    while(p != eol && isBlank(*p))
+                        p++;
+                    double value;
+                    const char* next = parseDouble(p, eol, value);
+                    if(next == p)
+                    {
+                        std::ostringstream message;
+                        message << "CSV row " << row + 1 << ": "
+                                << (p == eol ? "too few columns" : "column is not a number")
+                                << ", expected " << nColumn << " columns.";
+                        throw OpenANNException(message.str());
+                    }
+                    if(c < nInput)
+                        input(i, c) = value;
+                    else
+                        output(i, c - nInput) = value;
+                    p = next;
+                    while(p != eol && isBlank(*p))
+                        p++;
+                    if(p != eol && *p == ',')
+                        p++;
+                }
+            }
+            row++;
+            p = eol == range.end ? eol : eol + 1;
+        }
+    });
+}
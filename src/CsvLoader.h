@@ -0,0 +1,87 @@
+#ifndef CSVLOADER_H_
+#define CSVLOADER_H_
+
+#include <Eigen/Core>
+#include "MappedFile.h"
+#include "WorkerPool.h"
+#include <memory>
+#include <string>
+#include <vector>
+
+/**
+ * @class CsvLoader
+ *
+ * Parallel loader of numeric CSV files with any number of columns.
+ *
+ * open() maps the file and splits it into byte ranges that start at line
+ * boundaries, the rows of all ranges are counted in parallel. read() then
+ * parses the ranges in parallel directly into pre-sized matrices, each range
+ * writes its own rows. Fields are separated by ',' and may be surrounded by
+ * spaces or tabs. Empty lines and a header line that does not start with a
+ * number are skipped, columns after the last requested one are ignored.
+ *
+ * Numbers are parsed with an exact fast path for up to 19 significant
+ * digits and decimal exponents up to 22 (Clinger's algorithm), other
+ * numbers are parsed with the C++ streams in the classic locale. The result
+ * never depends on the locale of the process.
+ */
+class CsvLoader
+{
+public:
+    /**
+     * @param threads number of threads, 0 uses one thread per hardware thread
+     */
+    explicit CsvLoader(int threads = 0);
+    ~CsvLoader();
+
+    /**
+     * Map a file and count its rows.
+     * @param fileName name of the CSV file
+     * @return number of data rows
+     * @throws OpenANN::OpenANNException if the file cannot be read
+     */
+    int open(const std::string& fileName);
+    /**
+     * @return number of data rows of the opened file
+     */
+    int rows() const;
+    /**
+     * Parse the rows [startRow, endRow).
+     *
+     * The first input.cols() columns of each row are stored in input, the
+     * next output.cols() columns in output. Both matrices must have
+     * endRow - startRow rows.
+     *
+     * @throws OpenANN::OpenANNException if a row has too few columns or a
+     *         field is not a number
+     */
+    void read(int startRow, int endRow, Eigen::MatrixXd& input, Eigen::MatrixXd& output);
+
+    /**
+     * Parse a decimal floating point number.
+     * @param begin first character
+     * @param end end of the text
+     * @param value receives the number
+     * @return character after the number, begin if there is no number
+     */
+    static const char* parseDouble(const char* begin, const char* end, double& value);
+
+private:
+    /**
+     * Byte range of the file, starts at the beginning of a line.
+     */
+    struct Range
+    {
+        const char* begin;
+        const char* end;
+        int firstRow;
+        int rows;
+    };
+
+    std::unique_ptr<WorkerPool> pool;
+    std::unique_ptr<const MappedFile> file;
+    std::vector<Range> ranges;
+    int nRows;
+};
+
+#endif // CSVLOADER_H_
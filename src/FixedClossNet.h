@@ -0,0 +1,319 @@
+#ifndef FIXEDCLOSSNET_H_
+#define FIXEDCLOSSNET_H_
+
+#include <OpenANN/ActivationFunctions.h>
+#include <OpenANN/util/AssertionMacros.h>
+#include <OpenANN/util/OpenANNException.h>
+#include <Eigen/Core>
+#include <sstream>
+#include "BPLayer.h"
+#include "ClossNet.h"
+
+namespace FixedClossNetDetail
+{
+/**
+ * Same definitions as OpenANN::activationFunction().
+ */
+template<typename Vector>
+inline void activate(ActivationFunction act, Vector& a)
+{
+    switch(act)
+    {
+    case OpenANN::LOGISTIC:
+        a.array() = 1.0 / (1.0 + (-a.array().max(-45.0).min(45.0)).exp());
+        break;
+    case OpenANN::TANH:
+        a.array() = a.array().tanh();
+        break;
+    case OpenANN::TANH_SCALED:
+        a.array() = 1.7159 * (0.66666667 * a.array()).tanh();
+        break;
+    case OpenANN::RECTIFIER:
+        a.array() = a.array().max(0.0);
+        break;
+    case OpenANN::LINEAR:
+    default:
+        break;
+    }
+}
+
+/**
+ * Fully connected layer with bias, see BPLayer.
+ */
+template<int Inputs, int Units>
+struct Layer
+{
+    typedef Eigen::Matrix<double, Units, 1> Output;
+    // layout of the parameters of a BPLayer
+    typedef Eigen::Matrix<double, Units, Inputs + 1, Eigen::RowMajor> Block;
+
+    static const int PARAMETERS = Units * (Inputs + 1);
+
+    Eigen::Matrix<double, Units, Inputs> weight;
+    Output bias;
+    ActivationFunction act;
+
+    Layer()
+        : weight(Eigen::Matrix<double, Units, Inputs>::Zero()),
+          bias(Output::Zero()), act(OpenANN::TANH)
+    {
+    }
+
+    void setParameters(const double* parameters)
+    {
+        Eigen::Map<const Block> block(parameters);
+        weight = block.template leftCols<Inputs>();
+        bias = block.col(Inputs);
+    }
+
+    void getParameters(double* parameters) const
+    {
+        Eigen::Map<Block> block(parameters);
+        block.template leftCols<Inputs>() = weight;
+        block.col(Inputs) = bias;
+    }
+
+    template<typename Input>
+    Output operator()(const Input& x) const
+    {
+        Output a = bias;
+        a.noalias() += weight * x;
+        activate(act, a);
+        return a;
+    }
+};
+
+/**
+ * Layers Units[0]-Units[1], Units[1]-Units[2], ...
+ */
+template<int... Units>
+struct Layers;
+
+template<int Inputs, int Units>
+struct Layers<Inputs, Units>
+{
+    typedef typename Layer<Inputs, Units>::Output Output;
+    static const int LAYERS = 1;
+    static const int PARAMETERS = Layer<Inputs, Units>::PARAMETERS;
+
+    Layer<Inputs, Units> layer;
+
+    void setParameters(const double* parameters)
+    {
+        layer.setParameters(parameters);
+    }
+    void getParameters(double* parameters) const
+    {
+        layer.getParameters(parameters);
+    }
+    void setActivationFunctions(const ActivationFunction* act)
+    {
+        layer.act = *act;
+    }
+    void getActivationFunctions(ActivationFunction* act) const
+    {
+        *act = layer.act;
+    }
+    template<typename Input>
+    Output operator()(const Input& x) const
+    {
+        return layer(x);
+    }
+};
+
+template<int Inputs, int Units, int... Rest>
+struct Layers<Inputs, Units, Rest...>
+{
+    typedef typename Layers<Units, Rest...>::Output Output;
+    static const int LAYERS = 1 + Layers<Units, Rest...>::LAYERS;
+    static const int PARAMETERS = Layer<Inputs, Units>::PARAMETERS
+                                  + Layers<Units, Rest...>::PARAMETERS;
+
+    Layer<Inputs, Units> layer;
+    Layers<Units, Rest...> next;
+
+    void setParameters(const double* parameters)
+    {
+        layer.setParameters(parameters);
+        next.setParameters(parameters + Layer<Inputs, Units>::PARAMETERS);
+    }
+    void getParameters(double* parameters) const
+    {
+        layer.getParameters(parameters);
+        next.getParameters(parameters + Layer<Inputs, Units>::PARAMETERS);
+    }
+    void setActivationFunctions(const ActivationFunction* act)
+    {
+        layer.act = *act;
+        next.setActivationFunctions(act + 1);
+    }
+    void getActivationFunctions(ActivationFunction* act) const
+    {
+        *act = layer.act;
+        next.getActivationFunctions(act + 1);
+    }
+    template<typename Input>
+    Output operator()(const Input& x) const
+    {
+        return next(layer(x));
+    }
+};
+} // namespace FixedClossNetDetail
+
+/**
+ * @class FixedClossNet
+ *
+ * Feedforward network of fully connected layers with a topology that is
+ * fixed at compile time, for scoring with a trained ClossNet.
+ *
+ * The template arguments are the number of inputs and the number of units
+ * of each layer, e.g. FixedClossNet<2, 20, 20, 1> for the default network
+ * of ClossTrain. Weights and biases are fixed-size Eigen matrices, so a
+ * prediction does not allocate memory and calls no virtual function, and
+ * Eigen can unroll and vectorize the products of small layers. Each layer
+ * has a bias and an activation function (TANH until loaded).
+ *
+ * Parameters are loaded from a trained network, which must consist of an
+ * input layer and BPLayers with bias of the same sizes:
+ * \code
+ * ClossNet net;
+ * net.loadMapped("model.net");
+ * FixedClossNet<2, 20, 20, 1> fixed(net);
+ * FixedClossNet<2, 20, 20, 1>::Output y = fixed(Eigen::Vector2d(0.5, -0.5));
+ * \endcode
+ *
+ * Large topologies should use ClossNet, the parameters of a FixedClossNet
+ * are stored in the object itself.
+ */
+template<int... Units>
+class FixedClossNet
+{
+    static_assert(sizeof...(Units) >= 2, "FixedClossNet needs at least one layer");
+
+    typedef FixedClossNetDetail::Layers<Units...> Layers;
+    static constexpr int SIZES[sizeof...(Units)] = { Units... };
+
+    Layers layers;
+
+public:
+    static const int INPUTS = SIZES[0];
+    static const int OUTPUTS = SIZES[sizeof...(Units) - 1];
+    /**
+     * Number of layers without the input layer.
+     */
+    static const int LAYERS = Layers::LAYERS;
+    /**
+     * Number of parameters, same as ClossNet::dimension().
+     */
+    static const int PARAMETERS = Layers::PARAMETERS;
+
+    typedef Eigen::Matrix<double, INPUTS, 1> Input;
+    typedef typename Layers::Output Output;
+
+    EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+
+    /**
+     * Create network with zero weights and TANH activation functions.
+     */
+    FixedClossNet() {}
+    /**
+     * Create network with the parameters of a trained network.
+     */
+    explicit FixedClossNet(ClossNet& net)
+    {
+        load(net);
+    }
+
+    /**
+     * Copy parameters and activation functions of a trained network.
+     * @param net input layer and LAYERS BPLayers with bias of the sizes
+     *            given by the template arguments
+     */
+    void load(ClossNet& net)
+    {
+        if(net.numberOflayers() != (unsigned int) LAYERS + 1)
+        {
+            std::stringstream msg;
+            msg << "FixedClossNet has " << LAYERS << " layers, the network has "
+                << (int) net.numberOflayers() - 1 << ".";
+            throw OpenANN::OpenANNException(msg.str());
+        }
+        if(net.getOutputInfo(0).outputs() != INPUTS)
+            throw OpenANN::OpenANNException("FixedClossNet has a different number of inputs.");
+
+        ActivationFunction act[LAYERS];
+        for(int l = 1; l <= LAYERS; l++)
+        {
+            BPLayer* layer = dynamic_cast<BPLayer*>(&net.getLayer(l));
+            if(!layer)
+                throw OpenANN::OpenANNException("FixedClossNet can only load BPLayers.");
+            if(net.getOutputInfo(l).outputs() != SIZES[l]
+               || layer->dimension() != SIZES[l] * (SIZES[l - 1] + 1))
+            {
+                std::stringstream msg;
+                msg << "Layer " << l << " of the network does not have "
+                    << SIZES[l] << " units with bias.";
+                throw OpenANN::OpenANNException(msg.str());
+            }
+            act[l - 1] = layer->getActivationFunction();
+        }
+        // the layers store their parameters one after another in this layout
+        const Eigen::VectorXd& parameters = net.currentParameters();
+        OPENANN_CHECK_EQUALS(parameters.size(), PARAMETERS);
+        layers.setParameters(parameters.data());
+        layers.setActivationFunctions(act);
+    }
+
+    /**
+     * Set the parameters in the layout of ClossNet::currentParameters().
+     * @param parameters PARAMETERS values, [W|b] row by row for each layer
+     */
+    void setParameters(const Eigen::VectorXd& parameters)
+    {
+        OPENANN_CHECK_EQUALS(parameters.size(), PARAMETERS);
+        layers.setParameters(parameters.data());
+    }
+    Eigen::VectorXd getParameters() const
+    {
+        Eigen::VectorXd parameters(PARAMETERS);
+        layers.getParameters(parameters.data());
+        return parameters;
+    }
+    /**
+     * @param act LAYERS activation functions, the first is the one of the
+     *            first hidden layer
+     */
+    void setActivationFunctions(const ActivationFunction* act)
+    {
+        layers.setActivationFunctions(act);
+    }
+    void getActivationFunctions(ActivationFunction* act) const
+    {
+        layers.getActivationFunctions(act);
+    }
+
+    /**
+     * Predict one input.
+     */
+    Output operator()(const Input& x) const
+    {
+        return layers(x);
+    }
+    /**
+     * Predict a batch.
+     * @param X each row is an input
+     * @param Y receives one row of outputs per input
+     */
+    void predict(const Eigen::MatrixXd& X, Eigen::MatrixXd& Y) const
+    {
+        OPENANN_CHECK_EQUALS(X.cols(), INPUTS);
+        Y.resize(X.rows(), OUTPUTS);
+        for(int n = 0; n < X.rows(); n++)
+            Y.row(n) = layers(X.row(n).transpose()).transpose();
+    }
+};
+
+template<int... Units>
+constexpr int FixedClossNet<Units...>::SIZES[sizeof...(Units)];
+
+#endif // FIXEDCLOSSNET_H_
@@ -1,16 +1,33 @@
 #define OPENANN_LOG_NAMESPACE "LMA"
 
 #include "InterruptableLMA.h"
+#include "Profiler.h"
 #include <OpenANN/optimization/Optimizable.h>
 #include <OpenANN/optimization/StoppingInterrupt.h>
 #include <OpenANN/util/AssertionMacros.h>
 #include <OpenANN/util/Random.h>
 #include <OpenANN/util/OpenANNException.h>
 #include <OpenANN/io/Logger.h>
+#include <algorithm>
+#include <chrono>
 #include <limits>
 
+namespace
+{
+// examples of one Jacobian tile, small enough to keep the scratch in cache
+const int TILE_ROWS = 256;
+
+typedef std::chrono::steady_clock Clock;
+
+double secondsSince(Clock::time_point start)
+{
+    return std::chrono::duration<double>(Clock::now() - start).count();
+}
+}
+
 InterruptableLMA::InterruptableLMA()
-    : opt(0), iteration(-1), n(-1)
+    : opt(0), batchOpt(0), iteration(-1), n(-1),
+      functionTime(0.0), jacobianTime(0.0), solveTime(0.0)
 {
 }
 
@@ -28,6 +45,38 @@ double InterruptableLMA::currentError() const
     return errorValues.mean();
 }
 
+void InterruptableLMA::setThreads(int threads)
+{
+    if(threads == 0)
+        threads = WorkerPool::hardwareThreads();
+    if(threads < 0)
+        throw OpenANN::OpenANNException("Number of threads must not be negative.");
+    if(threads == 1)
+        pool.reset();
+    else
+        pool.reset(new WorkerPool(threads));
+}
+
+int InterruptableLMA::getThreads() const
+{
+    return pool ? pool->threads() : 1;
+}
+
+double InterruptableLMA::lastFunctionTime() const
+{
+    return functionTime;
+}
+
+double InterruptableLMA::lastJacobianTime() const
+{
+    return jacobianTime;
+}
+
+double InterruptableLMA::lastSolveTime() const
+{
+    return solveTime;
+}
+
 void InterruptableLMA::setOptimizable(Optimizable& opt)
 {
     this->opt = &opt;
@@ -46,7 +95,10 @@ void InterruptableLMA::optimize()
     {
         OPENANN_DEBUG << "Iteration #" << iteration
                       << ", training error = "
-                      << OpenANN::FloatingPointFormatter(errorValues.mean(), 4);
+                      << OpenANN::FloatingPointFormatter(errorValues.mean(), 4)
+                      << ", Jacobian " << jacobianTime << " s"
+                      << ", function " << functionTime << " s"
+                      << ", solve " << solveTime << " s";
         if(interrupt.isSignaled())
         {
             reset();
@@ -62,20 +114,44 @@ bool InterruptableLMA::step()
         initialize();
     OPENANN_CHECK(n > 0);
 
+    const Clock::time_point stepStart = Clock::now();
+    functionTime = jacobianTime = 0.0;
     try
     {
-        while(alglib_impl::minlmiteration(state.c_ptr(), &envState))
+        while(true)
         {
+            {
+                // alglib's part of the iteration, i.e. solving the damped system
+                CLOSS_PROFILE_SCOPE("lma solve");
+                if(!alglib_impl::minlmiteration(state.c_ptr(), &envState))
+                    break;
+            }
             if(state.needfi)
             {
                 for(unsigned i = 0; i < n; i++)
                     parameters(i) = state.x[i];
-                opt->setParameters(parameters);
-                for(unsigned i = 0; i < opt->examples(); i++)
-                    state.fi[i] = opt->error(i);
+                const Clock::time_point start = Clock::now();
+                {
+                    CLOSS_PROFILE_SCOPE("lma residuals");
+                    opt->setParameters(parameters);
+                    if(batchOpt)
+                    {
+                        evaluateBatch(false);
+                    }
+                    else
+                    {
+                        for(unsigned i = 0; i < opt->examples(); i++)
+                        {
+                            errorValues(i) = opt->error(i);
+                            state.fi[i] = errorValues(i);
+                        }
+                    }
+                }
+                functionTime += secondsSince(start);
                 if(iteration != state.c_ptr()->repiterationscount)
                 {
                     iteration = state.c_ptr()->repiterationscount;
+                    solveTime = secondsSince(stepStart) - functionTime - jacobianTime;
                     opt->finishedIteration();
                     return true;
                 }
@@ -85,17 +161,30 @@ bool InterruptableLMA::step()
             {
                 for(unsigned i = 0; i < n; i++)
                     parameters(i) = state.x[i];
-                opt->setParameters(parameters);
-                for(int ex = 0; ex < opt->examples(); ex++)
+                const Clock::time_point start = Clock::now();
                 {
-                    opt->errorGradient(ex, errorValues(ex), gradient);
-                    state.fi[ex] = errorValues(ex);
-                    for(unsigned d = 0; d < opt->dimension(); d++)
-                        state.j[ex][d] = gradient(d);
+                    CLOSS_PROFILE_SCOPE("lma jacobian");
+                    opt->setParameters(parameters);
+                    if(batchOpt)
+                    {
+                        evaluateBatch(true);
+                    }
+                    else
+                    {
+                        for(int ex = 0; ex < opt->examples(); ex++)
+                        {
+                            opt->errorGradient(ex, errorValues(ex), gradient);
+                            state.fi[ex] = errorValues(ex);
+                            for(unsigned d = 0; d < opt->dimension(); d++)
+                                state.j[ex][d] = gradient(d);
+                        }
+                    }
                 }
+                jacobianTime += secondsSince(start);
                 if(iteration != state.c_ptr()->repiterationscount)
                 {
                     iteration = state.c_ptr()->repiterationscount;
+                    solveTime = secondsSince(stepStart) - functionTime - jacobianTime;
                     opt->finishedIteration();
                     return true;
                 }
@@ -117,6 +206,39 @@ bool InterruptableLMA::step()
     return false;
 }
 
+void InterruptableLMA::evaluateBatch(bool computeJacobian)
+{
+    const int N = opt->examples();
+    const int tiles = (N + TILE_ROWS - 1) / TILE_ROWS;
+    const int tasks = pool ? std::min(pool->threads(), tiles) : 1;
+    batchOpt->reserveWorkspaces(tasks);
+
+    if(computeJacobian)
+    {
+        // tiles are written directly into alglib's Jacobian
+        jacobianRows.resize(N);
+        for(int ex = 0; ex < N; ex++)
+            jacobianRows[ex] = state.j[ex];
+    }
+
+    // each task owns one workspace and a contiguous range of tiles
+    std::function<void(int)> task = [&](int t)
+    {
+        const int end = (long) N * (t + 1) / tasks;
+        for(int start = (long) N * t / tasks; start < end; start += TILE_ROWS)
+            batchOpt->errorJacobian(t, start, std::min(start + TILE_ROWS, end),
+                                    errorValues.data() + start,
+                                    computeJacobian ? &jacobianRows[start] : 0);
+    };
+    if(pool)
+        pool->run(tasks, task);
+    else
+        task(0);
+
+    for(int ex = 0; ex < N; ex++)
+        state.fi[ex] = errorValues(ex);
+}
+
 Eigen::VectorXd InterruptableLMA::result()
 {
     OPENANN_CHECK(opt);
@@ -142,6 +264,11 @@ void InterruptableLMA::initialize()
     errorValues.resize(opt->examples());
     gradient.resize(n);
 
+    // use batched residuals and Jacobian if available
+    batchOpt = dynamic_cast<BatchOptimizable*>(opt);
+    if(batchOpt && !batchOpt->providesJacobian())
+        batchOpt = 0;
+
     xIn.setcontent(n, opt->currentParameters().data());
 
     // Initialize optimizer
@@ -5,6 +5,10 @@
 #include <OpenANN/optimization/StoppingCriteria.h>
 #include <Eigen/Core>
 #include <optimization.h>
+#include "BatchOptimizable.h"
+#include "WorkerPool.h"
+#include <memory>
+#include <vector>
 
 using OpenANN::Optimizer;
 using OpenANN::Optimizable;
@@ -14,12 +18,18 @@ class InterruptableLMA : public Optimizer
 {
     StoppingCriteria stop;
     Optimizable* opt; // do not delete
+    BatchOptimizable* batchOpt; // same object as opt, null if not supported
     Eigen::VectorXd optimum;
     int iteration, n;
     alglib_impl::ae_state envState;
     Eigen::VectorXd parameters, errorValues, gradient;
+    std::vector<double*> jacobianRows;
     alglib::real_1d_array xIn;
     alglib::minlmstate state;
+    // threads that evaluate tiles of the Jacobian, null for one thread
+    std::unique_ptr<WorkerPool> pool;
+    // seconds spent in the last iteration
+    double functionTime, jacobianTime, solveTime;
 public:
     InterruptableLMA();
     virtual ~InterruptableLMA();
@@ -32,9 +42,43 @@ public:
 
     int currentIteration() const;
     double currentError() const;
+
+    /**
+     * Set number of threads that evaluate the residuals and the Jacobian.
+     *
+     * Only used if the optimizable is a BatchOptimizable that provides the
+     * Jacobian.
+     *
+     * @param threads 0 uses one thread per hardware thread
+     */
+    void setThreads(int threads);
+    int getThreads() const;
+
+    /**
+     * @name Timing of the last iteration
+     * Wall clock time in seconds of the last step().
+     */
+    ///@{
+    /**
+     * @return time spent computing residuals
+     */
+    double lastFunctionTime() const;
+    /**
+     * @return time spent computing the Jacobian and its residuals
+     */
+    double lastJacobianTime() const;
+    /**
+     * @return time spent in alglib, i.e. solving the damped system
+     */
+    double lastSolveTime() const;
+    ///@}
 protected:
     void initialize();
     void reset();
+    /**
+     * Evaluate residuals and optionally the Jacobian in parallel tiles.
+     */
+    void evaluateBatch(bool computeJacobian);
 };
 
 #endif // INTERRUPTABLELMA_H
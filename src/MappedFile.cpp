@@ -0,0 +1,89 @@
+#include "MappedFile.h"
+#include <OpenANN/util/AssertionMacros.h>
+#include <OpenANN/util/OpenANNException.h>
+
+#if defined(_WIN32)
+#include <fstream>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+using OpenANN::OpenANNException;
+
+#if defined(_WIN32)
+
+MappedFile::MappedFile(const std::string& fileName, bool writable)
+    : address(0), length(0), writable(writable)
+{
+    std::ifstream file(fileName.c_str(), std::ios::binary | std::ios::ate);
+    if(!file)
+        throw OpenANNException("Could not open '" + fileName + "'.");
+    length = file.tellg();
+    file.seekg(0);
+    // double elements keep the data aligned for parameter views
+    buffer.resize((length + sizeof(double) - 1) / sizeof(double));
+    address = reinterpret_cast<char*>(buffer.data());
+    if(!file.read(address, length))
+        throw OpenANNException("Could not read '" + fileName + "'.");
+}
+
+MappedFile::~MappedFile()
+{
+}
+
+#else
+
+MappedFile::MappedFile(const std::string& fileName, bool writable)
+    : address(0), length(0), writable(writable)
+{
+    const int fd = open(fileName.c_str(), O_RDONLY);
+    if(fd < 0)
+        throw OpenANNException("Could not open '" + fileName + "'.");
+    struct stat status;
+    if(fstat(fd, &status) != 0)
+    {
+        close(fd);
+        throw OpenANNException("Could not stat '" + fileName + "'.");
+    }
+    length = status.st_size;
+    if(length > 0)
+    {
+        const int protection = writable ? PROT_READ | PROT_WRITE : PROT_READ;
+        void* mapping = mmap(0, length, protection, MAP_PRIVATE, fd, 0);
+        if(mapping == MAP_FAILED)
+        {
+            close(fd);
+            throw OpenANNException("Could not map '" + fileName + "'.");
+        }
+        address = static_cast<char*>(mapping);
+    }
+    // the mapping stays valid after the descriptor is closed
+    close(fd);
+}
+
+MappedFile::~MappedFile()
+{
+    if(address)
+        munmap(address, length);
+}
+
+#endif
+
+char* MappedFile::data()
+{
+    OPENANN_CHECK(writable);
+    return address;
+}
+
+const char* MappedFile::data() const
+{
+    return address;
+}
+
+std::size_t MappedFile::size() const
+{
+    return length;
+}
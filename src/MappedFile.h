@@ -0,0 +1,52 @@
+#ifndef MAPPEDFILE_H_
+#define MAPPEDFILE_H_
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+/**
+ * @class MappedFile
+ *
+ * File mapped into memory.
+ *
+ * The mapping is private and read-only by default, so the kernel can drop
+ * its pages at any time and files larger than the memory can be mapped. A
+ * writable mapping shares its pages with the page cache until they are
+ * modified, modifications are never written back to the file. Linux
+ * reserves memory for the whole length of a writable mapping, so only map
+ * small files writable. The mapping is page aligned. On systems without mmap
+ * the file is read into a buffer of doubles instead, which is only aligned
+ * for doubles.
+ */
+class MappedFile
+{
+public:
+    /**
+     * Map a file.
+     * @param fileName name of the file
+     * @param writable allow modifications through data()
+     * @throws OpenANN::OpenANNException if the file cannot be mapped
+     */
+    explicit MappedFile(const std::string& fileName, bool writable = false);
+    ~MappedFile();
+
+    /**
+     * @return start of the mapping, only for files mapped writable
+     */
+    char* data();
+    const char* data() const;
+    std::size_t size() const;
+
+private:
+    MappedFile(const MappedFile&);
+    MappedFile& operator=(const MappedFile&);
+
+    char* address;
+    std::size_t length;
+    bool writable;
+    // used instead of the mapping if mmap is not available
+    std::vector<double> buffer;
+};
+
+#endif // MAPPEDFILE_H_
@@ -0,0 +1,29 @@
+#ifndef MATRIXDATASET_H_
+#define MATRIXDATASET_H_
+
+#include <OpenANN/io/DataSet.h>
+#include <Eigen/Core>
+
+/**
+ * @class MatrixDataSet
+ *
+ * Data set that stores its instances and targets as rows of two matrices.
+ *
+ * OpenANN::DataSet only gives access to one instance at a time. Learners
+ * that detect this interface can use blocks of the matrices directly instead
+ * of copying every instance and target of a mini-batch.
+ */
+class MatrixDataSet : public OpenANN::DataSet
+{
+public:
+    /**
+     * @return samples() rows and inputs() cols
+     */
+    virtual Eigen::MatrixXd& inputMatrix() = 0;
+    /**
+     * @return samples() rows and outputs() cols
+     */
+    virtual Eigen::MatrixXd& outputMatrix() = 0;
+};
+
+#endif // MATRIXDATASET_H_
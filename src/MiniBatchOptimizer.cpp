@@ -0,0 +1,240 @@
+#define OPENANN_LOG_NAMESPACE "MiniBatch"
+
+#include "MiniBatchOptimizer.h"
+#include <OpenANN/optimization/Optimizable.h>
+#include <OpenANN/optimization/StoppingInterrupt.h>
+#include <OpenANN/util/AssertionMacros.h>
+#include <OpenANN/util/OpenANNException.h>
+#include <OpenANN/util/Random.h>
+#include <OpenANN/io/Logger.h>
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <sstream>
+
+MiniBatchOptimizer::MiniBatchOptimizer(Method method, double learningRate,
+                                       int batchSize, double momentum)
+    : opt(0), method(method), learningRate(learningRate), batchSize(batchSize),
+      momentum(momentum), beta1(momentum), beta2(0.999), epsilon(1e-8),
+      iteration(-1), error(0.0), lastError(0.0), shuffleWindow(0), updates(0)
+{
+    if(learningRate <= 0.0)
+        throw OpenANN::OpenANNException("Learning rate must be positive.");
+    if(batchSize < 1)
+        throw OpenANN::OpenANNException("Batch size must be positive.");
+}
+
+MiniBatchOptimizer::~MiniBatchOptimizer()
+{
+}
+
+MiniBatchOptimizer& MiniBatchOptimizer::setAdamParameters(double beta2, double epsilon)
+{
+    this->beta2 = beta2;
+    this->epsilon = epsilon;
+    return *this;
+}
+
+MiniBatchOptimizer& MiniBatchOptimizer::setShuffleWindow(int examples)
+{
+    if(examples < 0)
+        throw OpenANN::OpenANNException("Shuffle window must not be negative.");
+    shuffleWindow = examples;
+    return *this;
+}
+
+int MiniBatchOptimizer::currentIteration() const
+{
+    return iteration;
+}
+
+double MiniBatchOptimizer::currentError() const
+{
+    return error;
+}
+
+void MiniBatchOptimizer::setOptimizable(Optimizable& opt)
+{
+    this->opt = &opt;
+    OpenANN::RandomNumberGenerator rng;
+    shuffleRng.seed(rng.generateInt(0, std::numeric_limits<int>::max()));
+}
+
+void MiniBatchOptimizer::setStopCriteria(const StoppingCriteria& stop)
+{
+    this->stop = stop;
+}
+
+void MiniBatchOptimizer::optimize()
+{
+    OPENANN_CHECK(opt);
+    OpenANN::StoppingInterrupt interrupt;
+    while(step())
+    {
+        OPENANN_DEBUG << "Iteration #" << iteration
+                      << ", training error = "
+                      << OpenANN::FloatingPointFormatter(error, 4);
+        if(interrupt.isSignaled())
+        {
+            reset();
+            break;
+        }
+    }
+}
+
+bool MiniBatchOptimizer::step()
+{
+    OPENANN_CHECK(opt);
+    if(iteration < 0)
+        initialize();
+
+    // shuffle, each epoch visits the examples in a different order
+    const int size = indices.size();
+    const int window = shuffleWindow > 0 ? shuffleWindow : std::max(size, 1);
+    for(int start = 0; start < size; start += window)
+    {
+        for(int i = std::min(start + window, size) - 1; i > start; i--)
+        {
+            std::uniform_int_distribution<int> index(start, i);
+            std::swap(indices[i], indices[index(shuffleRng)]);
+        }
+    }
+
+    lastError = error;
+    error = 0.0;
+    for(std::vector<int>::const_iterator start = indices.begin();
+        start != indices.end();)
+    {
+        std::vector<int>::const_iterator end =
+            start + std::min<long>(batchSize, indices.end() - start);
+        double value = 0.0;
+        opt->errorGradient(start, end, value, gradient);
+        error += value * (end - start);
+        update();
+        opt->setParameters(parameters);
+        start = end;
+    }
+    error /= indices.size();
+    iteration++;
+    opt->finishedIteration();
+
+    // stopping criteria
+    bool done = false;
+    if(stop.maximalIterations != StoppingCriteria::defaultValue.maximalIterations &&
+       iteration >= stop.maximalIterations)
+    {
+        OPENANN_DEBUG << "Maximum number of iterations reached.";
+        done = true;
+    }
+    if(stop.minimalValue != StoppingCriteria::defaultValue.minimalValue &&
+       error <= stop.minimalValue)
+    {
+        OPENANN_DEBUG << "Error is below threshold.";
+        done = true;
+    }
+    if(iteration > 1 &&
+       stop.minimalValueDifferences != StoppingCriteria::defaultValue.minimalValueDifferences &&
+       std::fabs(lastError - error) <= stop.minimalValueDifferences)
+    {
+        OPENANN_DEBUG << "Error difference is below threshold.";
+        done = true;
+    }
+    if(!std::isfinite(error))
+    {
+        OPENANN_DEBUG << "Error diverged, decrease the learning rate.";
+        done = true;
+    }
+    if(done)
+    {
+        reset();
+        return false;
+    }
+    return true;
+}
+
+void MiniBatchOptimizer::update()
+{
+    switch(method)
+    {
+    case MOMENTUM:
+        velocity = momentum * velocity - learningRate * gradient;
+        parameters += velocity;
+        break;
+    case NESTEROV:
+        parameters += momentum * momentum * velocity
+                      - (1.0 + momentum) * learningRate * gradient;
+        velocity = momentum * velocity - learningRate * gradient;
+        break;
+    case ADAM:
+    {
+        updates++;
+        velocity = beta1 * velocity + (1.0 - beta1) * gradient;
+        secondMoment = beta2 * secondMoment
+                       + (1.0 - beta2) * gradient.cwiseAbs2();
+        const double rate = learningRate * std::sqrt(1.0 - std::pow(beta2, updates))
+                            / (1.0 - std::pow(beta1, updates));
+        parameters.array() -= rate * velocity.array()
+                              / (secondMoment.array().sqrt() + epsilon);
+        break;
+    }
+    }
+}
+
+Eigen::VectorXd MiniBatchOptimizer::result()
+{
+    OPENANN_CHECK(opt);
+    if(iteration != -1)
+        reset();
+    opt->setParameters(optimum);
+    return optimum;
+}
+
+std::string MiniBatchOptimizer::name()
+{
+    std::stringstream stream;
+    stream << "Mini-Batch ";
+    switch(method)
+    {
+    case MOMENTUM:
+        stream << "Momentum SGD";
+        break;
+    case NESTEROV:
+        stream << "Nesterov SGD";
+        break;
+    case ADAM:
+        stream << "Adam";
+        break;
+    }
+    stream << " (learning rate = " << learningRate
+           << ", batch size = " << batchSize << ")";
+    return stream.str();
+}
+
+void MiniBatchOptimizer::initialize()
+{
+    const int n = opt->dimension();
+    parameters = opt->currentParameters();
+    gradient.resize(n);
+    velocity.setZero(n);
+    secondMoment.setZero(n);
+    updates = 0;
+
+    indices.resize(opt->examples());
+    for(size_t i = 0; i < indices.size(); i++)
+        indices[i] = i;
+
+    error = lastError = std::numeric_limits<double>::max();
+    iteration = 0;
+}
+
+void MiniBatchOptimizer::reset()
+{
+    optimum = parameters;
+    opt->setParameters(optimum);
+
+    OPENANN_DEBUG << "Terminated:";
+    OPENANN_DEBUG << iteration << " iterations";
+    OPENANN_DEBUG << "Error = " << error;
+
+    iteration = -1;
+}
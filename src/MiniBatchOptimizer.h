@@ -0,0 +1,103 @@
+#ifndef MINIBATCHOPTIMIZER_H
+#define MINIBATCHOPTIMIZER_H
+
+#include <OpenANN/optimization/Optimizer.h>
+#include <OpenANN/optimization/StoppingCriteria.h>
+#include <Eigen/Core>
+#include <random>
+#include <vector>
+
+using OpenANN::Optimizer;
+using OpenANN::Optimizable;
+using OpenANN::StoppingCriteria;
+
+/**
+ * @class MiniBatchOptimizer
+ *
+ * First-order optimizers that follow the gradient of shuffled mini-batches.
+ *
+ * Gradients are computed with errorGradient(startN, endN, ...), so
+ * ClossNet evaluates each mini-batch in one (possibly data-parallel) pass.
+ * Supported update rules:
+ *
+ * - MOMENTUM: \f$ v = \mu v - \eta g, x = x + v \f$
+ * - NESTEROV: Nesterov's accelerated gradient in the formulation of
+ *   Sutskever et al., \f$ x = x + \mu^2 v - (1 + \mu) \eta g \f$
+ * - ADAM: Kingma and Ba with bias corrected moment estimates
+ *
+ * Each call of step() processes one epoch, i.e. every example once. The
+ * shuffle generator is seeded from RandomNumberGenerator in
+ * setOptimizable(), so a run is reproducible with OpenANN's seed and
+ * optimizers in different threads do not share random state.
+ */
+class MiniBatchOptimizer : public Optimizer
+{
+public:
+    enum Method
+    {
+        MOMENTUM,
+        NESTEROV,
+        ADAM
+    };
+
+private:
+    StoppingCriteria stop;
+    Optimizable* opt; // do not delete
+    Method method;
+    double learningRate;
+    int batchSize;
+    double momentum;
+    double beta1, beta2, epsilon;
+    Eigen::VectorXd optimum;
+    int iteration;
+    // mean error of the last epoch and the one before
+    double error, lastError;
+    Eigen::VectorXd parameters, gradient, velocity, secondMoment;
+    std::vector<int> indices;
+    std::mt19937 shuffleRng;
+    int shuffleWindow;
+    long updates;
+public:
+    /**
+     * @param method update rule
+     * @param learningRate step size \f$ \eta \f$
+     * @param batchSize number of examples per mini-batch
+     * @param momentum \f$ \mu \f$ of MOMENTUM and NESTEROV, \f$ \beta_1 \f$
+     *                 of ADAM
+     */
+    MiniBatchOptimizer(Method method = MOMENTUM, double learningRate = 0.01,
+                       int batchSize = 32, double momentum = 0.9);
+    virtual ~MiniBatchOptimizer();
+    virtual void setOptimizable(Optimizable& opt);
+    virtual void setStopCriteria(const StoppingCriteria& stop);
+    virtual void optimize();
+    virtual bool step();
+    virtual Eigen::VectorXd result();
+    virtual std::string name();
+
+    int currentIteration() const;
+    /**
+     * @return mean error of the examples during the last epoch
+     */
+    double currentError() const;
+
+    /**
+     * Set the second moment decay and the regularization constant of Adam.
+     */
+    MiniBatchOptimizer& setAdamParameters(double beta2, double epsilon);
+    /**
+     * Shuffle examples only within consecutive windows.
+     *
+     * The windows are visited in order, so a StreamingDataSet with chunks
+     * of the same size is read sequentially.
+     *
+     * @param examples size of a window, 0 shuffles all examples
+     */
+    MiniBatchOptimizer& setShuffleWindow(int examples);
+protected:
+    void initialize();
+    void reset();
+    void update();
+};
+
+#endif // MINIBATCHOPTIMIZER_H
@@ -0,0 +1,142 @@
+#include "PredictionPlane.h"
+#include "ClossNet.h"
+#include "Profiler.h"
+#include <OpenANN/util/AssertionMacros.h>
+#include <OpenANN/util/OpenANNException.h>
+#include <algorithm>
+
+using OpenANN::OpenANNException;
+
+namespace
+{
+// grid points that are forwarded through the learner at once
+const int TILE_POINTS = 4096;
+}
+
+PredictionPlane::PredictionPlane(int resolution, double min, double max, int threads)
+    : gridResolution(0), rangeMin(min), rangeMax(max)
+{
+    setResolution(resolution);
+    setThreads(threads);
+}
+
+void PredictionPlane::setResolution(int resolution)
+{
+    if(resolution <= 0)
+        throw OpenANNException("Resolution must be positive.");
+    gridResolution = resolution;
+    plane.assign((std::size_t) resolution * resolution, 0.0f);
+}
+
+int PredictionPlane::resolution() const
+{
+    return gridResolution;
+}
+
+void PredictionPlane::setRange(double min, double max)
+{
+    rangeMin = min;
+    rangeMax = max;
+}
+
+double PredictionPlane::minimum() const
+{
+    return rangeMin;
+}
+
+double PredictionPlane::maximum() const
+{
+    return rangeMax;
+}
+
+void PredictionPlane::setThreads(int threads)
+{
+    if(threads == 0)
+        threads = WorkerPool::hardwareThreads();
+    if(threads < 0)
+        throw OpenANNException("Number of threads must not be negative.");
+    if(threads == 1)
+        pool.reset();
+    else if(!pool || pool->threads() != threads)
+        pool.reset(new WorkerPool(threads));
+}
+
+int PredictionPlane::threads() const
+{
+    return pool ? pool->threads() : 1;
+}
+
+double PredictionPlane::coordinate(int i) const
+{
+    if(gridResolution == 1)
+        return rangeMin;
+    return rangeMin + (rangeMax - rangeMin) * i / (gridResolution - 1);
+}
+
+void PredictionPlane::compute(Learner& learner)
+{
+    CLOSS_PROFILE_SCOPE("prediction");
+    ClossNet* clossNet = dynamic_cast<ClossNet*>(&learner);
+    if(clossNet && !clossNet->providesJacobian())
+        clossNet = 0;
+
+    // each task owns a contiguous range of grid rows
+    const int rowsPerTile = std::max(1, TILE_POINTS / gridResolution);
+    const int nTiles = (gridResolution + rowsPerTile - 1) / rowsPerTile;
+    const int tasks = pool && clossNet ? std::min(pool->threads(), nTiles) : 1;
+    if((int) tiles.size() < tasks)
+        tiles.resize(tasks);
+    if(clossNet)
+        clossNet->reserveWorkspaces(tasks);
+
+    std::function<void(int)> task = [&](int t)
+    {
+        computeRows(learner, clossNet, t, (long) gridResolution * t / tasks,
+                    (long) gridResolution * (t + 1) / tasks);
+    };
+    if(tasks > 1)
+        pool->run(tasks, task);
+    else
+        task(0);
+}
+
+void PredictionPlane::computeRows(Learner& learner, ClossNet* clossNet, int task,
+                                  int startY, int endY)
+{
+    Tile& tile = tiles[task];
+    const int rowsPerTile = std::max(1, TILE_POINTS / gridResolution);
+    for(int y0 = startY; y0 < endY; y0 += rowsPerTile)
+    {
+        const int y1 = std::min(y0 + rowsPerTile, endY);
+        tile.input.resize((y1 - y0) * gridResolution, 2);
+        for(int y = y0, n = 0; y < y1; y++)
+        {
+            const double yy = coordinate(y);
+            for(int x = 0; x < gridResolution; x++, n++)
+            {
+                tile.input(n, 0) = coordinate(x);
+                tile.input(n, 1) = yy;
+            }
+        }
+
+        if(clossNet)
+            clossNet->predict(task, tile.input, tile.output);
+        else
+            tile.output = learner(tile.input);
+        OPENANN_CHECK_EQUALS(tile.output.rows(), tile.input.rows());
+
+        float* values = &plane[(std::size_t) y0 * gridResolution];
+        for(int n = 0; n < tile.output.rows(); n++)
+            values[n] = (float) tile.output(n, 0);
+    }
+}
+
+const std::vector<float>& PredictionPlane::values() const
+{
+    return plane;
+}
+
+float PredictionPlane::value(int x, int y) const
+{
+    return plane[(std::size_t) y * gridResolution + x];
+}
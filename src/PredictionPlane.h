@@ -0,0 +1,85 @@
+#ifndef PREDICTIONPLANE_H_
+#define PREDICTIONPLANE_H_
+
+#include <OpenANN/Learner.h>
+#include <Eigen/Core>
+#include "WorkerPool.h"
+#include <memory>
+#include <vector>
+
+using OpenANN::Learner;
+
+class ClossNet;
+
+/**
+ * @class PredictionPlane
+ *
+ * First output of a learner with two inputs on a square grid.
+ *
+ * The grid is split into tiles of whole grid rows and every tile is
+ * forwarded through the learner as one matrix. A ClossNet that consists of
+ * BPLayers is evaluated in parallel with ClossNet::predict(), other
+ * learners tile by tile on the calling thread.
+ *
+ * The values are stored row by row in a flat buffer, the first input is
+ * the column and the second input is the row:
+ * \code
+ * value(x, y) == values()[y * resolution() + x]
+ * \endcode
+ */
+class PredictionPlane
+{
+public:
+    /**
+     * @param resolution number of grid points along each input
+     * @param min coordinate of the first grid point
+     * @param max coordinate of the last grid point
+     * @param threads 0 uses one thread per hardware thread
+     */
+    PredictionPlane(int resolution = 100, double min = 0.0, double max = 1.0,
+                    int threads = 1);
+
+    void setResolution(int resolution);
+    int resolution() const;
+    void setRange(double min, double max);
+    double minimum() const;
+    double maximum() const;
+    void setThreads(int threads);
+    int threads() const;
+
+    /**
+     * @return input value of grid point i along each axis
+     */
+    double coordinate(int i) const;
+
+    /**
+     * Evaluate the learner at every grid point.
+     */
+    void compute(Learner& learner);
+
+    const std::vector<float>& values() const;
+    float value(int x, int y) const;
+
+private:
+    struct Tile
+    {
+        Eigen::MatrixXd input, output;
+    };
+
+    /**
+     * Evaluate the grid rows [startY, endY) in tiles.
+     * @param clossNet learner if it supports ClossNet::predict(), else null
+     * @param task index of the tile and the ClossNet workspace
+     */
+    void computeRows(Learner& learner, ClossNet* clossNet, int task,
+                     int startY, int endY);
+
+    int gridResolution;
+    double rangeMin, rangeMax;
+    std::vector<float> plane;
+    std::unique_ptr<WorkerPool> pool;
+    // scratch memory of each task
+    std::vector<Tile> tiles;
+};
+
+#endif // PREDICTIONPLANE_H_
@@ -0,0 +1,322 @@
+#include "Profiler.h"
+#include <OpenANN/util/OpenANNException.h>
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+#include <limits>
+#include <ostream>
+#include <sstream>
+
+namespace
+{
+// Chrome traces use microseconds
+void writeMicroseconds(std::ostream& stream, int64_t nanoseconds)
+{
+    stream << nanoseconds / 1000 << '.' << std::setw(3) << std::setfill('0')
+           << nanoseconds % 1000 << std::setfill(' ');
+}
+
+void writeString(std::ostream& stream, const std::string& s)
+{
+    stream << '"';
+    for(size_t i = 0; i < s.size(); i++)
+    {
+        if(s[i] == '"' || s[i] == '\\')
+            stream << '\\';
+        stream << s[i];
+    }
+    stream << '"';
+}
+}
+
+Profiler::PhaseFamily::PhaseFamily(const char* name)
+    : name(name)
+{
+    for(int i = 0; i <= MAX_INDEX; i++)
+        phases[i].store(-1, std::memory_order_relaxed);
+}
+
+int Profiler::PhaseFamily::phase(int index)
+{
+    index = std::max(0, std::min(index, (int) MAX_INDEX));
+    int id = phases[index].load(std::memory_order_acquire);
+    if(id < 0)
+    {
+        std::ostringstream phaseName;
+        phaseName << name << ' ';
+        if(index == MAX_INDEX)
+            phaseName << MAX_INDEX << '+';
+        else
+            phaseName << index;
+        // registering twice returns the same id
+        id = instance().phase(phaseName.str());
+        phases[index].store(id, std::memory_order_release);
+    }
+    return id;
+}
+
+Profiler::Thread::Thread(int id)
+    : id(id), droppedEvents(0)
+{
+    for(int p = 0; p < MAX_PHASES; p++)
+    {
+        calls[p].store(0, std::memory_order_relaxed);
+        totals[p].store(0, std::memory_order_relaxed);
+    }
+}
+
+Profiler::Iterations::Iterations()
+    : lastTotal(0), count(0), sum(0.0),
+      min(std::numeric_limits<double>::infinity()), max(0.0)
+{
+}
+
+Profiler::Profiler()
+    : tracing(false), epoch(now())
+{
+}
+
+Profiler& Profiler::instance()
+{
+    static Profiler profiler;
+    return profiler;
+}
+
+int64_t Profiler::now()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+int Profiler::phase(const std::string& name)
+{
+    return registerName(name, false);
+}
+
+int Profiler::counter(const std::string& name)
+{
+    return registerName(name, true);
+}
+
+int Profiler::registerName(const std::string& name, bool counter)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    for(size_t p = 0; p < names.size(); p++)
+        if(names[p] == name)
+            return p;
+    if(names.size() >= (size_t) MAX_PHASES)
+        throw OpenANN::OpenANNException("Too many profiler phases.");
+    names.push_back(name);
+    counters.push_back(counter);
+    perIteration.push_back(Iterations());
+    return names.size() - 1;
+}
+
+Profiler::Thread& Profiler::thread()
+{
+    // threads are never removed, so the pointer stays valid
+    static thread_local Thread* current = 0;
+    if(!current)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        threads.push_back(std::unique_ptr<Thread>(new Thread(threads.size())));
+        current = threads.back().get();
+    }
+    return *current;
+}
+
+void Profiler::record(int phase, int64_t start, int64_t end)
+{
+    Thread& t = thread();
+    // only this thread writes, other threads only read the totals
+    t.calls[phase].store(t.calls[phase].load(std::memory_order_relaxed) + 1,
+                         std::memory_order_relaxed);
+    t.totals[phase].store(t.totals[phase].load(std::memory_order_relaxed) + end - start,
+                          std::memory_order_relaxed);
+    if(tracing.load(std::memory_order_relaxed))
+        addEvent(t, phase, start, end - start);
+}
+
+void Profiler::count(int counter, long long value)
+{
+    Thread& t = thread();
+    t.calls[counter].store(t.calls[counter].load(std::memory_order_relaxed) + 1,
+                           std::memory_order_relaxed);
+    t.totals[counter].store(t.totals[counter].load(std::memory_order_relaxed) + value,
+                            std::memory_order_relaxed);
+    if(tracing.load(std::memory_order_relaxed))
+        addEvent(t, counter, now(), value);
+}
+
+void Profiler::addEvent(Thread& t, int phase, int64_t start, int64_t value)
+{
+    if(t.events.size() >= (size_t) MAX_EVENTS)
+    {
+        t.droppedEvents.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+    Event event = {phase, start, value};
+    t.events.push_back(event);
+}
+
+int64_t Profiler::total(int phase) const
+{
+    int64_t sum = 0;
+    for(size_t t = 0; t < threads.size(); t++)
+        sum += threads[t]->totals[phase].load(std::memory_order_relaxed);
+    return sum;
+}
+
+void Profiler::finishIteration()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    for(size_t p = 0; p < perIteration.size(); p++)
+    {
+        Iterations& it = perIteration[p];
+        const int64_t sum = total(p);
+        const double value = sum - it.lastTotal;
+        it.lastTotal = sum;
+        it.count++;
+        it.sum += value;
+        it.min = std::min(it.min, value);
+        it.max = std::max(it.max, value);
+    }
+    iterationEnds.push_back(now());
+}
+
+int Profiler::iterations() const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return iterationEnds.size();
+}
+
+void Profiler::setTracing(bool enabled)
+{
+    tracing.store(enabled);
+}
+
+bool Profiler::isTracing() const
+{
+    return tracing.load();
+}
+
+void Profiler::reset()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    for(size_t t = 0; t < threads.size(); t++)
+    {
+        Thread& thread = *threads[t];
+        for(int p = 0; p < MAX_PHASES; p++)
+        {
+            thread.calls[p].store(0);
+            thread.totals[p].store(0);
+        }
+        thread.events.clear();
+        thread.droppedEvents.store(0);
+    }
+    std::fill(perIteration.begin(), perIteration.end(), Iterations());
+    iterationEnds.clear();
+    epoch = now();
+}
+
+std::vector<Profiler::Statistics> Profiler::statistics() const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    std::vector<Statistics> result(names.size());
+    for(size_t p = 0; p < names.size(); p++)
+    {
+        Statistics& s = result[p];
+        const Iterations& it = perIteration[p];
+        s.name = names[p];
+        s.counter = counters[p];
+        s.calls = 0;
+        for(size_t t = 0; t < threads.size(); t++)
+            s.calls += threads[t]->calls[p].load(std::memory_order_relaxed);
+        s.total = total(p);
+        s.iterations = it.count;
+        s.mean = it.count ? it.sum / it.count : 0.0;
+        s.min = it.count ? it.min : 0.0;
+        s.max = it.max;
+    }
+    return result;
+}
+
+void Profiler::report(std::ostream& stream) const
+{
+    const std::vector<Statistics> stats = statistics();
+    size_t width = 5;
+    for(size_t p = 0; p < stats.size(); p++)
+        width = std::max(width, stats[p].name.size());
+
+    stream << std::left << std::setw(width) << "phase" << std::right
+           << std::setw(12) << "calls" << std::setw(14) << "total ms"
+           << std::setw(14) << "mean ms/it" << std::setw(14) << "min ms/it"
+           << std::setw(14) << "max ms/it" << '\n';
+    stream << std::fixed << std::setprecision(3);
+    for(size_t p = 0; p < stats.size(); p++)
+    {
+        const Statistics& s = stats[p];
+        // counters are printed in their own unit
+        const double scale = s.counter ? 1.0 : 1e-6;
+        stream << std::left << std::setw(width) << s.name << std::right
+               << std::setw(12) << s.calls << std::setw(14) << s.total * scale
+               << std::setw(14) << s.mean * scale << std::setw(14) << s.min * scale
+               << std::setw(14) << s.max * scale << (s.counter ? " (count)" : "")
+               << '\n';
+    }
+    stream << iterations() << " iterations" << std::endl;
+}
+
+void Profiler::writeTrace(std::ostream& stream) const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    stream << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n"
+           << "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,"
+           << "\"args\":{\"name\":\"ClossANN\"}}";
+    for(size_t t = 0; t < threads.size(); t++)
+    {
+        const Thread& thread = *threads[t];
+        stream << ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":"
+               << thread.id << ",\"args\":{\"name\":\"thread " << thread.id;
+        if(thread.droppedEvents.load())
+            stream << " (" << thread.droppedEvents.load() << " events dropped)";
+        stream << "\"}}";
+        for(size_t e = 0; e < thread.events.size(); e++)
+        {
+            const Event& event = thread.events[e];
+            stream << ",\n{\"name\":";
+            writeString(stream, names[event.phase]);
+            stream << ",\"cat\":\"closs\",\"pid\":1,\"tid\":" << thread.id
+                   << ",\"ts\":";
+            writeMicroseconds(stream, std::max<int64_t>(event.start - epoch, 0));
+            if(counters[event.phase])
+            {
+                stream << ",\"ph\":\"C\",\"args\":{\"value\":" << event.value << "}}";
+            }
+            else
+            {
+                stream << ",\"ph\":\"X\",\"dur\":";
+                writeMicroseconds(stream, event.value);
+                stream << '}';
+            }
+        }
+    }
+    for(size_t i = 0; i < iterationEnds.size(); i++)
+    {
+        stream << ",\n{\"name\":\"iteration\",\"cat\":\"closs\",\"ph\":\"i\","
+               << "\"s\":\"g\",\"pid\":1,\"tid\":0,\"ts\":";
+        writeMicroseconds(stream, std::max<int64_t>(iterationEnds[i] - epoch, 0));
+        stream << ",\"args\":{\"iteration\":" << i << "}}";
+    }
+    stream << "\n]}" << std::endl;
+}
+
+bool Profiler::writeTrace(const std::string& fileName) const
+{
+    std::ofstream file(fileName.c_str());
+    if(!file)
+        return false;
+    writeTrace(file);
+    return bool(file);
+}
@@ -0,0 +1,236 @@
+#ifndef PROFILER_H_
+#define PROFILER_H_
+
+#include <atomic>
+#include <cstdint>
+#include <iosfwd>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+/**
+ * @class Profiler
+ *
+ * Wall clock time and counters of the phases of a training run.
+ *
+ * Code is instrumented with the macros below. They only record something
+ * if CLOSS_PROFILE is defined (CMake option CLOSS_PROFILE), otherwise they
+ * compile to nothing:
+ * \code
+ * void f()
+ * {
+ *     CLOSS_PROFILE_SCOPE("phase");          // time until the end of the block
+ *     for(int l = 0; l < L; l++)
+ *     {
+ *         CLOSS_PROFILE_SCOPE_INDEXED("layer", l); // "layer 0", "layer 1", ...
+ *     }
+ *     CLOSS_PROFILE_COUNT("samples", n);      // add n to a counter
+ * }
+ * CLOSS_PROFILE_ITERATION();                  // end of an optimizer iteration
+ * \endcode
+ *
+ * Every thread records into its own buffers, a scope costs two clock reads
+ * and does not lock unless tracing is enabled. The totals of all threads
+ * are summed when an iteration finishes, which gives the time of each phase
+ * per iteration. With setTracing() every scope is also kept as an event and
+ * writeTrace() exports them in the Chrome trace event format, which can be
+ * opened in chrome://tracing or Perfetto.
+ *
+ * Phases are nested, the time of a phase includes the phases called by it.
+ */
+class Profiler
+{
+public:
+    /**
+     * Aggregated time of a phase or sum of a counter.
+     */
+    struct Statistics
+    {
+        std::string name;
+        bool counter;
+        // number of scopes or counted values
+        long long calls;
+        // nanoseconds or sum of the counted values
+        long long total;
+        // per finished iteration, in the unit of total
+        int iterations;
+        double mean, min, max;
+    };
+
+    /**
+     * Scoped timer, see CLOSS_PROFILE_SCOPE.
+     */
+    class Scope
+    {
+    public:
+        explicit Scope(int phase) : phase(phase), start(now()) {}
+        ~Scope() { instance().record(phase, start, now()); }
+    private:
+        Scope(const Scope&);
+        Scope& operator=(const Scope&);
+        int phase;
+        int64_t start;
+    };
+
+    /**
+     * Phases "name 0", "name 1", ... that are registered on first use,
+     * see CLOSS_PROFILE_SCOPE_INDEXED.
+     */
+    class PhaseFamily
+    {
+    public:
+        explicit PhaseFamily(const char* name);
+        /**
+         * @return phase of index, indices beyond MAX_INDEX share one phase
+         */
+        int phase(int index);
+        static const int MAX_INDEX = 32;
+    private:
+        std::string name;
+        std::atomic<int> phases[MAX_INDEX + 1];
+    };
+
+    static Profiler& instance();
+
+    /**
+     * Register a timed phase, a name is registered only once.
+     * @return id of the phase
+     */
+    int phase(const std::string& name);
+    /**
+     * Register a counter, a name is registered only once.
+     * @return id of the counter
+     */
+    int counter(const std::string& name);
+    void count(int counter, long long value);
+    void record(int phase, int64_t start, int64_t end);
+    /**
+     * Sum the totals of all threads and update the per iteration
+     * statistics.
+     */
+    void finishIteration();
+    int iterations() const;
+
+    /**
+     * Keep every scope as an event for writeTrace(), disabled by default.
+     * Each thread keeps at most MAX_EVENTS events.
+     */
+    void setTracing(bool enabled);
+    bool isTracing() const;
+    /**
+     * Forget all recorded times, counts and events.
+     * Must not be called while other threads record.
+     */
+    void reset();
+
+    /**
+     * @return phases and counters in the order of registration
+     */
+    std::vector<Statistics> statistics() const;
+    /**
+     * Print a table of all phases and counters.
+     */
+    void report(std::ostream& stream) const;
+    /**
+     * Write the events in Chrome trace event format (JSON).
+     * Must not be called while other threads record.
+     */
+    void writeTrace(std::ostream& stream) const;
+    /**
+     * @return false if the file cannot be written
+     */
+    bool writeTrace(const std::string& fileName) const;
+
+    /**
+     * @return nanoseconds of a monotonic clock
+     */
+    static int64_t now();
+
+    static const int MAX_PHASES = 256;
+    static const int MAX_EVENTS = 1 << 20;
+
+private:
+    struct Event
+    {
+        int phase;
+        int64_t start;
+        // duration of a scope, value of a counter
+        int64_t value;
+    };
+
+    /**
+     * Buffers of one thread, only written by that thread.
+     */
+    struct Thread
+    {
+        explicit Thread(int id);
+        int id;
+        std::atomic<int64_t> calls[MAX_PHASES];
+        std::atomic<int64_t> totals[MAX_PHASES];
+        std::vector<Event> events;
+        std::atomic<int64_t> droppedEvents;
+    };
+
+    struct Iterations
+    {
+        Iterations();
+        int64_t lastTotal;
+        int count;
+        double sum, min, max;
+    };
+
+    Profiler();
+    Profiler(const Profiler&);
+    Profiler& operator=(const Profiler&);
+
+    int registerName(const std::string& name, bool counter);
+    Thread& thread();
+    void addEvent(Thread& t, int phase, int64_t start, int64_t value);
+    int64_t total(int phase) const;
+
+    mutable std::mutex mutex;
+    std::vector<std::string> names;
+    std::vector<bool> counters;
+    std::vector<std::unique_ptr<Thread> > threads;
+    std::vector<Iterations> perIteration;
+    // end of each finished iteration
+    std::vector<int64_t> iterationEnds;
+    std::atomic<bool> tracing;
+    int64_t epoch;
+};
+
+#ifdef CLOSS_PROFILE
+
+#define CLOSS_PROFILE_CONCAT_(a, b) a##b
+#define CLOSS_PROFILE_CONCAT(a, b) CLOSS_PROFILE_CONCAT_(a, b)
+
+#define CLOSS_PROFILE_SCOPE(name) \
+    static const int CLOSS_PROFILE_CONCAT(profilePhase, __LINE__) = \
+        Profiler::instance().phase(name); \
+    Profiler::Scope CLOSS_PROFILE_CONCAT(profileScope, __LINE__)( \
+        CLOSS_PROFILE_CONCAT(profilePhase, __LINE__))
+
+#define CLOSS_PROFILE_SCOPE_INDEXED(name, index) \
+    static Profiler::PhaseFamily CLOSS_PROFILE_CONCAT(profileFamily, __LINE__)(name); \
+    Profiler::Scope CLOSS_PROFILE_CONCAT(profileScope, __LINE__)( \
+        CLOSS_PROFILE_CONCAT(profileFamily, __LINE__).phase(index))
+
+#define CLOSS_PROFILE_COUNT(name, value) \
+    do { \
+        static const int profileCounter = Profiler::instance().counter(name); \
+        Profiler::instance().count(profileCounter, value); \
+    } while(0)
+
+#define CLOSS_PROFILE_ITERATION() Profiler::instance().finishIteration()
+
+#else
+
+#define CLOSS_PROFILE_SCOPE(name) do {} while(0)
+#define CLOSS_PROFILE_SCOPE_INDEXED(name, index) do {} while(0)
+#define CLOSS_PROFILE_COUNT(name, value) do {} while(0)
+#define CLOSS_PROFILE_ITERATION() do {} while(0)
+
+#endif // CLOSS_PROFILE
+
+#endif // PROFILER_H_
@@ -0,0 +1,332 @@
+#include "StreamingDataSet.h"
+#include <OpenANN/util/AssertionMacros.h>
+#include <OpenANN/util/OpenANNException.h>
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <limits>
+#include <stdint.h>
+
+using OpenANN::OpenANNException;
+
+namespace
+{
+// binary row format, see StreamingDataSet::BinarySource
+const char ROW_MAGIC[8] = {'C', 'L', 'O', 'S', 'S', 'R', 'O', 'W'};
+const uint32_t ROW_VERSION = 1;
+const std::size_t ROW_HEADER_BYTES = 32;
+const std::size_t ROW_OFFSET = 64;
+
+bool littleEndian()
+{
+    const uint16_t one = 1;
+    return *reinterpret_cast<const unsigned char*>(&one) == 1;
+}
+
+/**
+ * Copy a little-endian value independent of the byte order of the host.
+ */
+template<typename T>
+T load(const char* data)
+{
+    char bytes[sizeof(T)];
+    std::memcpy(bytes, data, sizeof(T));
+    if(!littleEndian())
+        std::reverse(bytes, bytes + sizeof(T));
+    T value;
+    std::memcpy(&value, bytes, sizeof(T));
+    return value;
+}
+
+template<typename T>
+void store(std::ostream& stream, T value)
+{
+    char bytes[sizeof(T)];
+    std::memcpy(bytes, &value, sizeof(T));
+    if(!littleEndian())
+        std::reverse(bytes, bytes + sizeof(T));
+    stream.write(bytes, sizeof(T));
+}
+}
+
+StreamingDataSet::CsvSource::CsvSource(const std::string& fileName, int threads)
+    : loader(threads)
+{
+    loader.open(fileName);
+}
+
+int StreamingDataSet::CsvSource::rows() const
+{
+    return loader.rows();
+}
+
+void StreamingDataSet::CsvSource::read(int startRow, int endRow, Eigen::MatrixXd& input,
+                                       Eigen::MatrixXd& output)
+{
+    loader.read(startRow, endRow, input, output);
+}
+
+StreamingDataSet::BinarySource::BinarySource(const std::string& fileName)
+    : file(fileName), values(0), nRows(0), nColumns(0)
+{
+    const char* data = file.data();
+    if(file.size() < ROW_HEADER_BYTES
+       || std::memcmp(data, ROW_MAGIC, sizeof(ROW_MAGIC)) != 0)
+        throw OpenANNException("'" + fileName + "' is not a binary row file.");
+    if(load<uint32_t>(data + 8) != ROW_VERSION)
+        throw OpenANNException("'" + fileName + "' has an unsupported version.");
+    nColumns = load<uint32_t>(data + 12);
+    const uint64_t rows = load<uint64_t>(data + 16);
+    const uint64_t offset = load<uint64_t>(data + 24);
+    if(rows > (uint64_t) std::numeric_limits<int>::max() || offset < ROW_HEADER_BYTES
+       || offset + rows * nColumns * sizeof(double) > file.size())
+        throw OpenANNException("'" + fileName + "' is truncated.");
+    nRows = rows;
+    values = data + offset;
+}
+
+int StreamingDataSet::BinarySource::rows() const
+{
+    return nRows;
+}
+
+void StreamingDataSet::BinarySource::read(int startRow, int endRow, Eigen::MatrixXd& input,
+                                          Eigen::MatrixXd& output)
+{
+    OPENANN_CHECK(startRow >= 0 && endRow <= nRows && startRow <= endRow);
+    const int nInput = input.cols();
+    if(nInput + output.cols() > nColumns)
+        throw OpenANNException("Binary row file has too few columns.");
+    for(int r = startRow; r < endRow; r++)
+    {
+        const char* row = values + (std::size_t) r * nColumns * sizeof(double);
+        for(int c = 0; c < nInput; c++)
+            input(r - startRow, c) = load<double>(row + c * sizeof(double));
+        for(int c = 0; c < output.cols(); c++)
+            output(r - startRow, c) = load<double>(row + (nInput + c) * sizeof(double));
+    }
+}
+
+void StreamingDataSet::BinarySource::write(Source& source, int columns,
+                                           const std::string& fileName, int chunkRows)
+{
+    std::ofstream stream(fileName.c_str(), std::ios::binary);
+    stream.write(ROW_MAGIC, sizeof(ROW_MAGIC));
+    store<uint32_t>(stream, ROW_VERSION);
+    store<uint32_t>(stream, columns);
+    store<uint64_t>(stream, source.rows());
+    store<uint64_t>(stream, ROW_OFFSET);
+    for(std::size_t i = ROW_HEADER_BYTES; i < ROW_OFFSET; i++)
+        stream.put(0);
+
+    Eigen::MatrixXd input, output(0, 0);
+    for(int start = 0; start < source.rows(); start += chunkRows)
+    {
+        const int rows = std::min(chunkRows, source.rows() - start);
+        input.resize(rows, columns);
+        output.resize(rows, 0);
+        source.read(start, start + rows, input, output);
+        for(int r = 0; r < rows; r++)
+            for(int c = 0; c < columns; c++)
+                store<double>(stream, input(r, c));
+    }
+    if(!stream)
+        throw OpenANNException("Could not write '" + fileName + "'.");
+}
+
+bool StreamingDataSet::BinarySource::isBinary(const std::string& fileName)
+{
+    std::ifstream stream(fileName.c_str(), std::ios::binary);
+    char magic[sizeof(ROW_MAGIC)];
+    return stream.read(magic, sizeof(magic))
+           && std::memcmp(magic, ROW_MAGIC, sizeof(magic)) == 0;
+}
+
+StreamingDataSet::StreamingDataSet(std::unique_ptr<Source> source, int inputs, int outputs,
+                                   int startRow, int endRow, int chunkRows)
+    : source(std::move(source)), nInputs(inputs), nOutputs(outputs),
+      startRow(startRow), nSamples(0), nChunkRows(chunkRows), nChunks(0),
+      scaled(false), scale(1.0), offset(0.0), pending(-1), quit(false)
+{
+    if(endRow < 0)
+        endRow = this->source->rows();
+    if(startRow < 0 || startRow > endRow || endRow > this->source->rows())
+        throw OpenANNException("Invalid row range of streaming data set.");
+    if(chunkRows < 1)
+        throw OpenANNException("Chunk must contain at least one row.");
+    nSamples = endRow - startRow;
+    nChunks = (nSamples + chunkRows - 1) / chunkRows;
+    thread = std::thread(&StreamingDataSet::prefetch, this);
+}
+
+StreamingDataSet::~StreamingDataSet()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        quit = true;
+    }
+    changed.notify_all();
+    thread.join();
+}
+
+std::unique_ptr<StreamingDataSet::Source> StreamingDataSet::open(const std::string& fileName,
+                                                                 int threads)
+{
+    if(BinarySource::isBinary(fileName))
+        return std::unique_ptr<Source>(new BinarySource(fileName));
+    return std::unique_ptr<Source>(new CsvSource(fileName, threads));
+}
+
+void StreamingDataSet::scaleInputs(double min, double max)
+{
+    if(min >= max)
+        throw OpenANNException("Invalid scaling range.");
+    // the prefetch thread reads the scaling, change it only while idle
+    invalidate();
+    scaled = false;
+    double minData = std::numeric_limits<double>::max();
+    double maxData = -std::numeric_limits<double>::max();
+    forEachChunk([&](const Eigen::MatrixXd& input, const Eigen::MatrixXd&, int)
+    {
+        if(input.size() == 0)
+            return;
+        minData = std::min(minData, input.minCoeff());
+        maxData = std::max(maxData, input.maxCoeff());
+    });
+    invalidate();
+    scale = (max - min) / (maxData - minData);
+    offset = min - minData * scale;
+    scaled = true;
+}
+
+int StreamingDataSet::chunkRows() const
+{
+    return nChunkRows;
+}
+
+void StreamingDataSet::forEachChunk(const std::function<void(const Eigen::MatrixXd&,
+                                                             const Eigen::MatrixXd&, int)>& f)
+{
+    for(int c = 0; c < nChunks; c++)
+    {
+        if(current.index != c)
+            acquire(c);
+        f(current.input, current.output, c * nChunkRows);
+    }
+}
+
+int StreamingDataSet::samples()
+{
+    return nSamples;
+}
+
+int StreamingDataSet::inputs()
+{
+    return nInputs;
+}
+
+int StreamingDataSet::outputs()
+{
+    return nOutputs;
+}
+
+Eigen::VectorXd& StreamingDataSet::getInstance(int i)
+{
+    OPENANN_CHECK_WITHIN(i, 0, nSamples - 1);
+    const int chunk = i / nChunkRows;
+    if(chunk != current.index)
+        acquire(chunk);
+    instance = current.input.row(i - chunk * nChunkRows).transpose();
+    return instance;
+}
+
+Eigen::VectorXd& StreamingDataSet::getTarget(int i)
+{
+    OPENANN_CHECK_WITHIN(i, 0, nSamples - 1);
+    const int chunk = i / nChunkRows;
+    if(chunk != current.index)
+        acquire(chunk);
+    target = current.output.row(i - chunk * nChunkRows).transpose();
+    return target;
+}
+
+void StreamingDataSet::finishIteration(OpenANN::Learner& learner)
+{
+}
+
+void StreamingDataSet::acquire(int chunk)
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    // a running read may already fetch this chunk
+    changed.wait(lock, [this] { return pending < 0; });
+    if(exception)
+    {
+        std::exception_ptr error = exception;
+        exception = nullptr;
+        std::rethrow_exception(error);
+    }
+    if(next.index != chunk)
+    {
+        lock.unlock();
+        readChunk(chunk, next);
+        lock.lock();
+        next.index = chunk;
+    }
+    std::swap(current.index, next.index);
+    current.input.swap(next.input);
+    current.output.swap(next.output);
+
+    // the chunk after the last one is the first one of the next epoch
+    next.index = -1;
+    if(nChunks > 1)
+    {
+        pending = (chunk + 1) % nChunks;
+        changed.notify_all();
+    }
+}
+
+void StreamingDataSet::readChunk(int chunk, Chunk& buffer)
+{
+    const int first = chunk * nChunkRows;
+    const int rows = std::min(nChunkRows, nSamples - first);
+    buffer.input.resize(rows, nInputs);
+    buffer.output.resize(rows, nOutputs);
+    source->read(startRow + first, startRow + first + rows, buffer.input, buffer.output);
+    if(scaled)
+        buffer.input = (buffer.input.array() * scale + offset).matrix();
+}
+
+void StreamingDataSet::invalidate()
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    changed.wait(lock, [this] { return pending < 0; });
+    current.index = -1;
+    next.index = -1;
+}
+
+void StreamingDataSet::prefetch()
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    while(true)
+    {
+        changed.wait(lock, [this] { return quit || pending >= 0; });
+        if(quit)
+            return;
+        const int chunk = pending;
+        lock.unlock();
+        std::exception_ptr error;
+        try
+        {
+            readChunk(chunk, next);
+        }
+        catch(...)
+        {
+            error = std::current_exception();
+        }
+        lock.lock();
+        next.index = error ? -1 : chunk;
+        exception = error;
+        pending = -1;
+        changed.notify_all();
+    }
+}
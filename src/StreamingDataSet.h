@@ -0,0 +1,171 @@
+#ifndef STREAMINGDATASET_H_
+#define STREAMINGDATASET_H_
+
+#include <OpenANN/io/DataSet.h>
+#include <Eigen/Core>
+#include "CsvLoader.h"
+#include "MappedFile.h"
+#include <condition_variable>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+
+/**
+ * @class StreamingDataSet
+ *
+ * Data set that keeps only two chunks of examples in memory.
+ *
+ * The examples are read from a Source in chunks of consecutive rows. While
+ * the current chunk is used, a background thread reads the following one
+ * into a second buffer, so sequential access never waits for the disk.
+ * Random access works but reads a chunk for every jump to another chunk.
+ *
+ * Iterate the data set in order: ClossNet evaluates non-matrix data sets in
+ * blocks, MiniBatchOptimizer::setShuffleWindow() keeps mini-batches inside
+ * one chunk and StreamingLMA::setChunkSize() should equal chunkRows().
+ */
+class StreamingDataSet : public OpenANN::DataSet
+{
+public:
+    /**
+     * Rows of a file.
+     */
+    class Source
+    {
+    public:
+        virtual ~Source() {}
+        /**
+         * @return number of rows
+         */
+        virtual int rows() const = 0;
+        /**
+         * Read the rows [startRow, endRow), the first input.cols() columns
+         * to input, the next output.cols() columns to output.
+         */
+        virtual void read(int startRow, int endRow, Eigen::MatrixXd& input,
+                          Eigen::MatrixXd& output) = 0;
+    };
+
+    /**
+     * Rows of a CSV file, parsed with CsvLoader.
+     */
+    class CsvSource : public Source
+    {
+        CsvLoader loader;
+    public:
+        CsvSource(const std::string& fileName, int threads = 1);
+        virtual int rows() const;
+        virtual void read(int startRow, int endRow, Eigen::MatrixXd& input,
+                          Eigen::MatrixXd& output);
+    };
+
+    /**
+     * Rows of a binary file written by BinarySource::write().
+     *
+     * The file starts with a 32 byte header: magic "CLOSSROW", version,
+     * number of columns, number of rows and the offset of the first row.
+     * The rows follow as little-endian doubles.
+     */
+    class BinarySource : public Source
+    {
+        const MappedFile file;
+        const char* values;
+        int nRows, nColumns;
+    public:
+        explicit BinarySource(const std::string& fileName);
+        virtual int rows() const;
+        virtual void read(int startRow, int endRow, Eigen::MatrixXd& input,
+                          Eigen::MatrixXd& output);
+        /**
+         * Convert the rows of a source to a binary file chunk by chunk.
+         * @param columns number of columns to store
+         */
+        static void write(Source& source, int columns, const std::string& fileName,
+                          int chunkRows = 65536);
+        /**
+         * @return true if the file starts with the magic of the format
+         */
+        static bool isBinary(const std::string& fileName);
+    };
+
+    /**
+     * @param source rows of the file, a CsvSource or BinarySource is chosen
+     *               by open()
+     * @param inputs number of input columns
+     * @param outputs number of output columns following the inputs
+     * @param startRow first row of the data set
+     * @param endRow end of the data set, -1 for all rows
+     * @param chunkRows number of rows read at once
+     */
+    StreamingDataSet(std::unique_ptr<Source> source, int inputs, int outputs,
+                     int startRow = 0, int endRow = -1, int chunkRows = 65536);
+    virtual ~StreamingDataSet();
+
+    /**
+     * Create the source of a CSV or binary file.
+     * @param threads threads that parse CSV chunks
+     */
+    static std::unique_ptr<Source> open(const std::string& fileName, int threads = 1);
+
+    /**
+     * Scale inputs to [min, max] like OpenANN::scaleData(), which needs one
+     * pass over the data set to find the range.
+     */
+    void scaleInputs(double min, double max);
+    int chunkRows() const;
+    /**
+     * Call f(input, output, firstRow) for every chunk in order.
+     */
+    void forEachChunk(const std::function<void(const Eigen::MatrixXd&,
+                                               const Eigen::MatrixXd&, int)>& f);
+
+    virtual int samples();
+    virtual int inputs();
+    virtual int outputs();
+    virtual Eigen::VectorXd& getInstance(int i);
+    virtual Eigen::VectorXd& getTarget(int i);
+    virtual void finishIteration(OpenANN::Learner& learner);
+
+private:
+    StreamingDataSet(const StreamingDataSet&);
+    StreamingDataSet& operator=(const StreamingDataSet&);
+
+    struct Chunk
+    {
+        int index;
+        Eigen::MatrixXd input, output;
+        Chunk() : index(-1) {}
+    };
+
+    /**
+     * Make chunk the current one and start reading the next one.
+     */
+    void acquire(int chunk);
+    void readChunk(int chunk, Chunk& buffer);
+    /**
+     * Drop both buffers, e.g. after the scaling changed.
+     */
+    void invalidate();
+    void prefetch();
+
+    std::unique_ptr<Source> source;
+    int nInputs, nOutputs, startRow, nSamples, nChunkRows, nChunks;
+    // inputs are multiplied by scale and shifted by offset after reading
+    bool scaled;
+    double scale, offset;
+    Chunk current, next;
+    Eigen::VectorXd instance, target;
+
+    // prefetch thread, reads chunk pending into next
+    std::thread thread;
+    std::mutex mutex;
+    std::condition_variable changed;
+    int pending;
+    bool quit;
+    std::exception_ptr exception;
+};
+
+#endif // STREAMINGDATASET_H_
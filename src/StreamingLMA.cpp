@@ -0,0 +1,391 @@
+#define OPENANN_LOG_NAMESPACE "StreamingLMA"
+
+#include "StreamingLMA.h"
+#include "Profiler.h"
+#include <OpenANN/optimization/Optimizable.h>
+#include <OpenANN/optimization/StoppingInterrupt.h>
+#include <OpenANN/util/AssertionMacros.h>
+#include <OpenANN/util/OpenANNException.h>
+#include <OpenANN/io/Logger.h>
+#include <Eigen/Cholesky>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+
+namespace
+{
+// examples of one Jacobian tile, small enough to keep the scratch in cache
+const int TILE_ROWS = 256;
+// memory of the Jacobian chunk if no chunk size is set
+const long DEFAULT_CHUNK_BYTES = 64L << 20;
+// initial damping relative to the largest diagonal element of J^T J
+const double INITIAL_DAMPING = 1e-3;
+// no further improvement is possible with a larger damping
+const double MAXIMAL_DAMPING = 1e20;
+// step size threshold if no stopping criterion is set, same as alglib
+const double DEFAULT_MINIMAL_STEP = 1e-6;
+
+typedef std::chrono::steady_clock Clock;
+
+double secondsSince(Clock::time_point start)
+{
+    return std::chrono::duration<double>(Clock::now() - start).count();
+}
+}
+
+StreamingLMA::StreamingLMA()
+    : opt(0), batchOpt(0), iteration(-1), n(-1), chunkSize(0),
+      mu(-1.0), nu(2.0), sumOfSquares(0.0),
+      functionTime(0.0), jacobianTime(0.0), solveTime(0.0)
+{
+}
+
+StreamingLMA::~StreamingLMA()
+{
+}
+
+int StreamingLMA::currentIteration() const
+{
+    return iteration;
+}
+
+double StreamingLMA::currentError() const
+{
+    return errorValues.mean();
+}
+
+void StreamingLMA::setThreads(int threads)
+{
+    if(threads == 0)
+        threads = WorkerPool::hardwareThreads();
+    if(threads < 0)
+        throw OpenANN::OpenANNException("Number of threads must not be negative.");
+    if(threads == 1)
+        pool.reset();
+    else
+        pool.reset(new WorkerPool(threads));
+}
+
+int StreamingLMA::getThreads() const
+{
+    return pool ? pool->threads() : 1;
+}
+
+void StreamingLMA::setChunkSize(int examples)
+{
+    if(examples < 0)
+        throw OpenANN::OpenANNException("Chunk size must not be negative.");
+    chunkSize = examples;
+}
+
+double StreamingLMA::lastFunctionTime() const
+{
+    return functionTime;
+}
+
+double StreamingLMA::lastJacobianTime() const
+{
+    return jacobianTime;
+}
+
+double StreamingLMA::lastSolveTime() const
+{
+    return solveTime;
+}
+
+void StreamingLMA::setOptimizable(Optimizable& opt)
+{
+    this->opt = &opt;
+}
+
+void StreamingLMA::setStopCriteria(const StoppingCriteria& stop)
+{
+    this->stop = stop;
+}
+
+void StreamingLMA::optimize()
+{
+    OPENANN_CHECK(opt);
+    OpenANN::StoppingInterrupt interrupt;
+    while(step())
+    {
+        OPENANN_DEBUG << "Iteration #" << iteration
+                      << ", training error = "
+                      << OpenANN::FloatingPointFormatter(errorValues.mean(), 4)
+                      << ", Jacobian " << jacobianTime << " s"
+                      << ", function " << functionTime << " s"
+                      << ", solve " << solveTime << " s";
+        if(interrupt.isSignaled())
+        {
+            reset();
+            break;
+        }
+    }
+}
+
+bool StreamingLMA::step()
+{
+    OPENANN_CHECK(opt);
+    if(iteration < 0)
+        initialize();
+    OPENANN_CHECK(n > 0);
+
+    functionTime = jacobianTime = solveTime = 0.0;
+    Clock::time_point start = Clock::now();
+    opt->setParameters(parameters);
+    accumulate();
+    jacobianTime = secondsSince(start);
+    if(mu < 0.0)
+    {
+        mu = INITIAL_DAMPING * hessian.diagonal().maxCoeff();
+        if(mu <= 0.0)
+            mu = INITIAL_DAMPING;
+    }
+
+    // increase the damping until the step reduces the error
+    while(true)
+    {
+        start = Clock::now();
+        const bool positiveDefinite = solve();
+        solveTime += secondsSince(start);
+        if(positiveDefinite)
+        {
+            candidate = parameters + delta;
+            start = Clock::now();
+            opt->setParameters(candidate);
+            evaluateErrors(candidateErrors);
+            functionTime += secondsSince(start);
+
+            const double newSumOfSquares = candidateErrors.squaredNorm();
+            // reduction predicted by the linear model
+            const double predicted = delta.dot(mu * delta - jtr);
+            const double rho = predicted > 0.0 ?
+                               (sumOfSquares - newSumOfSquares) / predicted : -1.0;
+            if(rho > 0.0)
+            {
+                const bool done = converged(newSumOfSquares);
+                parameters.swap(candidate);
+                errorValues.swap(candidateErrors);
+                sumOfSquares = newSumOfSquares;
+                mu *= std::max(1.0 / 3.0, 1.0 - std::pow(2.0 * rho - 1.0, 3));
+                nu = 2.0;
+                iteration++;
+                opt->finishedIteration();
+                if(done)
+                {
+                    reset();
+                    return false;
+                }
+                return true;
+            }
+        }
+        mu *= nu;
+        nu *= 2.0;
+        if(!(mu < MAXIMAL_DAMPING))
+        {
+            OPENANN_DEBUG << "Stopping conditions are too stringent, "
+                          << "further improvement is impossible.";
+            reset();
+            return false;
+        }
+    }
+}
+
+Eigen::VectorXd StreamingLMA::result()
+{
+    OPENANN_CHECK(opt);
+    if (iteration != -1)
+        reset();
+    opt->setParameters(optimum);
+    return optimum;
+}
+
+std::string StreamingLMA::name()
+{
+    std::stringstream stream;
+    stream << "Levenberg-Marquardt Algorithm (streaming)";
+    return stream.str();
+}
+
+void StreamingLMA::initialize()
+{
+    n = opt->dimension();
+    const int N = opt->examples();
+
+    // use batched residuals and Jacobian if available
+    batchOpt = dynamic_cast<BatchOptimizable*>(opt);
+    if(batchOpt && !batchOpt->providesJacobian())
+        batchOpt = 0;
+
+    int rows = chunkSize > 0 ? chunkSize :
+               (int) std::max<long>(TILE_ROWS, DEFAULT_CHUNK_BYTES / (sizeof(double) * n));
+    rows = std::max(1, std::min(rows, N));
+    chunk.resize(rows, n);
+    chunkRows.resize(rows);
+    for(int r = 0; r < rows; r++)
+        chunkRows[r] = chunk.data() + (long) r * n;
+
+    // temporary vectors to avoid allocations
+    parameters = opt->currentParameters();
+    hessian.resize(n, n);
+    jtr.resize(n);
+    gradient.resize(n);
+    errorValues.resize(N);
+    candidateErrors.resize(N);
+
+    mu = -1.0;
+    nu = 2.0;
+    iteration = 0;
+}
+
+void StreamingLMA::reset()
+{
+    optimum = parameters;
+    opt->setParameters(optimum);
+
+    OPENANN_DEBUG << "Terminated:";
+    OPENANN_DEBUG << iteration << " iterations";
+    OPENANN_DEBUG << "Error = " << opt->error();
+
+    iteration = -1;
+}
+
+void StreamingLMA::accumulate()
+{
+    const int N = opt->examples();
+    hessian.setZero();
+    jtr.setZero();
+
+    // split the lower triangle into column blocks of similar area
+    const int blocks = pool ? 4 * pool->threads() : 1;
+    std::vector<int> blockStart(blocks + 1);
+    for(int b = 0; b <= blocks; b++)
+        blockStart[b] = n - (int) std::round(n * std::sqrt(1.0 - (double) b / blocks));
+
+    for(int startN = 0; startN < N; startN += chunk.rows())
+    {
+        const int endN = std::min<int>(startN + chunk.rows(), N);
+        {
+            CLOSS_PROFILE_SCOPE("lma jacobian");
+            evaluateChunk(startN, endN);
+        }
+        CLOSS_PROFILE_SCOPE("lma normal equations");
+        const auto J = chunk.topRows(endN - startN);
+        jtr.noalias() += J.transpose() * errorValues.segment(startN, endN - startN);
+
+        std::function<void(int)> task = [&](int b)
+        {
+            const int c0 = blockStart[b], c1 = blockStart[b + 1];
+            if(c0 < c1)
+                hessian.block(c0, c0, n - c0, c1 - c0).noalias() +=
+                    J.rightCols(n - c0).transpose() * J.middleCols(c0, c1 - c0);
+        };
+        if(pool)
+            pool->run(blocks, task);
+        else
+            task(0);
+    }
+    sumOfSquares = errorValues.squaredNorm();
+}
+
+void StreamingLMA::evaluateChunk(int startN, int endN)
+{
+    if(batchOpt)
+    {
+        evaluateTiles(startN, endN, errorValues.data() + startN, &chunkRows[0]);
+        return;
+    }
+    for(int ex = startN; ex < endN; ex++)
+    {
+        opt->errorGradient(ex, errorValues(ex), gradient);
+        chunk.row(ex - startN) = gradient.transpose();
+    }
+}
+
+void StreamingLMA::evaluateErrors(Eigen::VectorXd& values)
+{
+    CLOSS_PROFILE_SCOPE("lma residuals");
+    const int N = opt->examples();
+    if(batchOpt)
+    {
+        // chunk by chunk like accumulate(), streamed data sets are read in order
+        for(int startN = 0; startN < N; startN += chunk.rows())
+        {
+            const int endN = std::min<int>(startN + chunk.rows(), N);
+            evaluateTiles(startN, endN, values.data() + startN, 0);
+        }
+        return;
+    }
+    for(int ex = 0; ex < N; ex++)
+        values(ex) = opt->error(ex);
+}
+
+void StreamingLMA::evaluateTiles(int startN, int endN, double* values,
+                                 double* const* rows)
+{
+    const int N = endN - startN;
+    const int tiles = (N + TILE_ROWS - 1) / TILE_ROWS;
+    const int tasks = pool ? std::min(pool->threads(), tiles) : 1;
+    batchOpt->reserveWorkspaces(tasks);
+
+    // each task owns one workspace and a contiguous range of tiles
+    std::function<void(int)> task = [&](int t)
+    {
+        const int end = (long) N * (t + 1) / tasks;
+        for(int start = (long) N * t / tasks; start < end; start += TILE_ROWS)
+            batchOpt->errorJacobian(t, startN + start,
+                                    startN + std::min(start + TILE_ROWS, end),
+                                    values + start, rows ? rows + start : 0);
+    };
+    if(pool && tasks > 1)
+        pool->run(tasks, task);
+    else
+        task(0);
+}
+
+bool StreamingLMA::solve()
+{
+    CLOSS_PROFILE_SCOPE("lma solve");
+    Eigen::LLT<Eigen::MatrixXd, Eigen::Lower> llt;
+    hessian.diagonal().array() += mu;
+    llt.compute(hessian);
+    hessian.diagonal().array() -= mu;
+    if(llt.info() != Eigen::Success)
+        return false;
+    delta = -llt.solve(jtr);
+    return delta.allFinite();
+}
+
+bool StreamingLMA::converged(double newSumOfSquares)
+{
+    const double minimalSearchSpaceStep = stop.minimalSearchSpaceStep !=
+                                          StoppingCriteria::defaultValue.minimalSearchSpaceStep ?
+                                          stop.minimalSearchSpaceStep : 0.0;
+    const double minimalValueDifferences = stop.minimalValueDifferences !=
+                                           StoppingCriteria::defaultValue.minimalValueDifferences ?
+                                           stop.minimalValueDifferences : 0.0;
+    const int maximalIterations = stop.maximalIterations !=
+                                  StoppingCriteria::defaultValue.maximalIterations ?
+                                  stop.maximalIterations : 0;
+    const bool noCriteria = minimalSearchSpaceStep == 0.0 &&
+                            minimalValueDifferences == 0.0 && maximalIterations == 0;
+
+    if(maximalIterations > 0 && iteration + 1 >= maximalIterations)
+    {
+        OPENANN_DEBUG << "MaxIts steps was taken";
+        return true;
+    }
+    const double scale = std::max(std::max(sumOfSquares, newSumOfSquares), 1.0);
+    if(sumOfSquares - newSumOfSquares <= minimalValueDifferences * scale)
+    {
+        OPENANN_DEBUG << "Relative function improvement is below threshold.";
+        return true;
+    }
+    const double minimalStep = noCriteria ? DEFAULT_MINIMAL_STEP : minimalSearchSpaceStep;
+    if(delta.norm() <= minimalStep)
+    {
+        OPENANN_DEBUG << "Relative step is below threshold.";
+        return true;
+    }
+    return false;
+}
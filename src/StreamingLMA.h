@@ -0,0 +1,140 @@
+#ifndef STREAMINGLMA_H
+#define STREAMINGLMA_H
+
+#include <OpenANN/optimization/Optimizer.h>
+#include <OpenANN/optimization/StoppingCriteria.h>
+#include <Eigen/Core>
+#include "BatchOptimizable.h"
+#include "WorkerPool.h"
+#include <memory>
+#include <vector>
+
+using OpenANN::Optimizer;
+using OpenANN::Optimizable;
+using OpenANN::StoppingCriteria;
+
+/**
+ * Largest Jacobian (examples() x dimension() doubles) that applications let
+ * InterruptableLMA store, larger problems are trained with StreamingLMA.
+ */
+const double MAX_JACOBIAN_BYTES = 1024.0 * 1024.0 * 1024.0;
+
+/**
+ * @class StreamingLMA
+ *
+ * Levenberg-Marquardt algorithm that never stores the whole Jacobian.
+ *
+ * InterruptableLMA lets alglib store the examples() x dimension() Jacobian.
+ * This implementation computes the Jacobian in chunks of examples and only
+ * accumulates \f$ J^T J \f$ and \f$ J^T r \f$, so the memory scales with
+ * the squared number of parameters instead of the number of examples. The
+ * damped system \f$ (J^T J + \mu I) \delta = -J^T r \f$ is solved with a
+ * Cholesky decomposition and \f$ \mu \f$ is adapted with the gain ratio
+ * (Nielsen's strategy). Rejected steps reuse \f$ J^T J \f$ and only need
+ * the residuals.
+ *
+ * Each call of step() performs one accepted iteration, like InterruptableLMA.
+ */
+class StreamingLMA : public Optimizer
+{
+    typedef Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic, Eigen::RowMajor> RowMatrixXd;
+
+    StoppingCriteria stop;
+    Optimizable* opt; // do not delete
+    BatchOptimizable* batchOpt; // same object as opt, null if not supported
+    Eigen::VectorXd optimum;
+    int iteration, n, chunkSize;
+    // damping and its increase factor
+    double mu, nu;
+    // sum of squared residuals at parameters
+    double sumOfSquares;
+    Eigen::VectorXd parameters, candidate, delta, errorValues, candidateErrors, gradient;
+    // J^T J, only the lower triangle is used
+    Eigen::MatrixXd hessian;
+    // J^T r
+    Eigen::VectorXd jtr;
+    // Jacobian rows of the current chunk
+    RowMatrixXd chunk;
+    std::vector<double*> chunkRows;
+    std::unique_ptr<WorkerPool> pool;
+    // seconds spent in the last iteration
+    double functionTime, jacobianTime, solveTime;
+public:
+    StreamingLMA();
+    virtual ~StreamingLMA();
+    virtual void setOptimizable(Optimizable& opt);
+    virtual void setStopCriteria(const StoppingCriteria& stop);
+    virtual void optimize();
+    virtual bool step();
+    virtual Eigen::VectorXd result();
+    virtual std::string name();
+
+    int currentIteration() const;
+    double currentError() const;
+
+    /**
+     * Set number of threads that evaluate the residuals and the Jacobian
+     * and accumulate \f$ J^T J \f$.
+     * @param threads 0 uses one thread per hardware thread
+     */
+    void setThreads(int threads);
+    int getThreads() const;
+    /**
+     * Set number of examples whose Jacobian rows are stored at once.
+     * @param examples 0 chooses a chunk of about 64 MB, use
+     *                 StreamingDataSet::chunkRows() for streamed data sets
+     */
+    void setChunkSize(int examples);
+
+    /**
+     * @name Timing of the last iteration
+     * Wall clock time in seconds of the last step().
+     */
+    ///@{
+    /**
+     * @return time spent computing residuals of trial steps
+     */
+    double lastFunctionTime() const;
+    /**
+     * @return time spent computing the Jacobian and accumulating J^T J
+     */
+    double lastJacobianTime() const;
+    /**
+     * @return time spent solving the damped system
+     */
+    double lastSolveTime() const;
+    ///@}
+protected:
+    void initialize();
+    void reset();
+    /**
+     * Accumulate J^T J, J^T r and the residuals at parameters.
+     */
+    void accumulate();
+    /**
+     * Compute the Jacobian rows of the examples [startN, endN) in chunk.
+     */
+    void evaluateChunk(int startN, int endN);
+    /**
+     * Evaluate the examples [startN, endN) in parallel tiles.
+     * @param values receives endN - startN residuals
+     * @param rows receives the Jacobian rows, may be null
+     */
+    void evaluateTiles(int startN, int endN, double* values, double* const* rows);
+    /**
+     * Compute the residuals of all examples at the current parameters.
+     * @param values receives one residual per example
+     */
+    void evaluateErrors(Eigen::VectorXd& values);
+    /**
+     * Solve the damped system for delta.
+     * @return false if the system is not positive definite
+     */
+    bool solve();
+    /**
+     * @return true if the stopping criteria are satisfied
+     */
+    bool converged(double newSumOfSquares);
+};
+
+#endif // STREAMINGLMA_H
@@ -0,0 +1,100 @@
+#include "WorkerPool.h"
+
+WorkerPool::WorkerPool(int threads)
+    : task(0), tasks(0), nextTask(0), running(0), generation(0), quit(false)
+{
+    if(threads <= 0)
+        threads = hardwareThreads();
+    for(int t = 1; t < threads; t++)
+        workers.push_back(std::thread(&WorkerPool::work, this));
+}
+
+WorkerPool::~WorkerPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        quit = true;
+    }
+    wakeUp.notify_all();
+    for(std::vector<std::thread>::iterator w = workers.begin(); w != workers.end(); ++w)
+        w->join();
+}
+
+int WorkerPool::threads() const
+{
+    return workers.size() + 1;
+}
+
+int WorkerPool::hardwareThreads()
+{
+    const int n = std::thread::hardware_concurrency();
+    return n > 0 ? n : 1;
+}
+
+void WorkerPool::run(int tasks, const std::function<void(int)>& task)
+{
+    if(workers.empty() || tasks <= 1)
+    {
+        for(int t = 0; t < tasks; t++)
+            task(t);
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        this->task = &task;
+        this->tasks = tasks;
+        nextTask = 0;
+        running = workers.size() + 1;
+        exception = std::exception_ptr();
+        generation++;
+    }
+    wakeUp.notify_all();
+    execute();
+
+    std::unique_lock<std::mutex> lock(mutex);
+    finished.wait(lock, [this] { return running == 0; });
+    this->task = 0;
+    if(exception)
+        std::rethrow_exception(exception);
+}
+
+void WorkerPool::work()
+{
+    unsigned long seen = 0;
+    while(true)
+    {
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            wakeUp.wait(lock, [&] { return quit || generation != seen; });
+            if(quit)
+                return;
+            seen = generation;
+        }
+        execute();
+    }
+}
+
+void WorkerPool::execute()
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    while(nextTask < tasks)
+    {
+        const int t = nextTask++;
+        lock.unlock();
+        try
+        {
+            (*task)(t);
+        }
+        catch(...)
+        {
+            lock.lock();
+            if(!exception)
+                exception = std::current_exception();
+            lock.unlock();
+        }
+        lock.lock();
+    }
+    if(--running == 0)
+        finished.notify_all();
+}
@@ -0,0 +1,70 @@
+#ifndef WORKERPOOL_H_
+#define WORKERPOOL_H_
+
+#include <condition_variable>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/**
+ * @class WorkerPool
+ *
+ * Fixed set of threads that execute the tasks of a parallel loop.
+ *
+ * run() distributes task indices to the workers and the calling thread and
+ * returns when all tasks are done. Threads are started once and sleep
+ * between calls, so the pool can be used for every iteration of an
+ * optimizer.
+ */
+class WorkerPool
+{
+public:
+    /**
+     * @param threads number of threads including the calling thread,
+     *                0 uses one thread per hardware thread
+     */
+    explicit WorkerPool(int threads = 0);
+    ~WorkerPool();
+
+    /**
+     * @return number of threads including the calling thread
+     */
+    int threads() const;
+    /**
+     * Execute task(0), ..., task(tasks - 1) in parallel.
+     *
+     * The first exception thrown by a task is rethrown after all tasks
+     * finished.
+     *
+     * @param tasks number of tasks
+     * @param task function that executes one task, must be thread-safe
+     */
+    void run(int tasks, const std::function<void(int)>& task);
+
+    /**
+     * @return number of hardware threads, at least 1
+     */
+    static int hardwareThreads();
+
+private:
+    WorkerPool(const WorkerPool&);
+    WorkerPool& operator=(const WorkerPool&);
+
+    void work();
+    void execute();
+
+    std::vector<std::thread> workers;
+    std::mutex mutex;
+    std::condition_variable wakeUp;
+    std::condition_variable finished;
+    // state of the current run(), protected by mutex
+    const std::function<void(int)>* task;
+    int tasks, nextTask, running;
+    unsigned long generation;
+    bool quit;
+    std::exception_ptr exception;
+};
+
+#endif // WORKERPOOL_H_
@@ -0,0 +1,157 @@
+#include <OpenANN/ActivationFunctions.h>
+#include <Eigen/Core>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+
+#include "BPLayer.h"
+#include "ClossNet.h"
+#include "TestMacros.h"
+
+namespace
+{
+typedef Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic, Eigen::RowMajor> RowMatrixXd;
+
+/**
+ * input(3) -> bp(4, TANH) -> bp(2, LINEAR)
+ */
+void createNet(ClossNet& net)
+{
+    net.inputLayer(3);
+    net.bpLayer(4, OpenANN::TANH);
+    net.bpLayer(2, OpenANN::LINEAR);
+}
+
+void testDimension()
+{
+    ClossNet net;
+    createNet(net);
+    TEST_CHECK_EQUALS((int) net.dimension(), 4 * (3 + 1) + 2 * (4 + 1));
+    TEST_CHECK_EQUALS((int) net.currentParameters().size(), (int) net.dimension());
+}
+
+void testParameterRoundTrip()
+{
+    ClossNet net;
+    createNet(net);
+    const Eigen::VectorXd parameters = Eigen::VectorXd::Random(net.dimension());
+    net.setParameters(parameters);
+    TEST_CHECK_CLOSE(net.currentParameters(), parameters, 0.0);
+
+    // each layer owns a consecutive [W|b] block
+    int offset = 0;
+    for(int l = 1; l < 3; l++)
+    {
+        BPLayer& layer = dynamic_cast<BPLayer&>(net.getLayer(l));
+        TEST_CHECK_CLOSE(layer.getParameters(),
+                         parameters.segment(offset, layer.dimension()), 0.0);
+        offset += layer.dimension();
+    }
+    TEST_CHECK_EQUALS(offset, (int) net.dimension());
+}
+
+void testPredict()
+{
+    ClossNet net;
+    createNet(net);
+    const Eigen::VectorXd parameters = Eigen::VectorXd::Random(net.dimension());
+    net.setParameters(parameters);
+
+    // [W|b] row by row for each layer
+    const RowMatrixXd block1 = Eigen::Map<const RowMatrixXd>(parameters.data(), 4, 4);
+    const RowMatrixXd block2 = Eigen::Map<const RowMatrixXd>(parameters.data() + 16, 2, 5);
+    const Eigen::MatrixXd X = Eigen::MatrixXd::Random(10, 3);
+    Eigen::MatrixXd hidden = X * block1.leftCols(3).transpose();
+    hidden.rowwise() += block1.col(3).transpose();
+    hidden = hidden.array().tanh();
+    Eigen::MatrixXd expected = hidden * block2.leftCols(4).transpose();
+    expected.rowwise() += block2.col(4).transpose();
+
+    TEST_CHECK_CLOSE(net(X), expected, 1e-12);
+
+    net.reserveWorkspaces(1);
+    Eigen::MatrixXd Y;
+    net.predict(0, X, Y);
+    TEST_CHECK_CLOSE(Y, expected, 1e-12);
+
+    const Eigen::VectorXd x = X.row(0).transpose();
+    TEST_CHECK_CLOSE(net(x), expected.row(0).transpose(), 1e-12);
+}
+
+/**
+ * Random parameters and Closs constants that differ from the defaults.
+ */
+void createTrainedNet(ClossNet& net)
+{
+    createNet(net);
+    net.setParameters(Eigen::VectorXd::Random(net.dimension()));
+    net.setKernelSize(0.75);
+    net.setPValue(1.5);
+}
+
+void checkLoaded(ClossNet& loaded, ClossNet& net, double tolerance)
+{
+    TEST_CHECK_EQUALS((int) loaded.numberOflayers(), 3);
+    TEST_CHECK_EQUALS((int) loaded.dimension(), (int) net.dimension());
+    TEST_CHECK_CLOSE(loaded.currentParameters(), net.currentParameters(), tolerance);
+    TEST_CHECK_EQUALS(loaded.getKernelSize(), 0.75);
+    TEST_CHECK_EQUALS(loaded.getPValue(), 1.5);
+}
+
+void testSaveText()
+{
+    ClossNet net;
+    createTrainedNet(net);
+    std::stringstream stream;
+    net.save(stream, ClossNet::TEXT);
+
+    ClossNet loaded;
+    loaded.load(stream);
+    // the text format stores six significant digits
+    checkLoaded(loaded, net, 1e-5);
+}
+
+void testSaveBinary()
+{
+    const char* fileName = "ClossNetTest.net";
+    ClossNet net;
+    createTrainedNet(net);
+    {
+        std::ofstream file(fileName, std::ios::binary);
+        net.save(file, ClossNet::BINARY);
+    }
+
+    ClossNet streamed;
+    {
+        std::ifstream file(fileName, std::ios::binary);
+        streamed.load(file);
+    }
+    checkLoaded(streamed, net, 0.0);
+
+    ClossNet mapped;
+    mapped.loadMapped(fileName);
+    checkLoaded(mapped, net, 0.0);
+    const Eigen::MatrixXd X = Eigen::MatrixXd::Random(10, 3);
+    TEST_CHECK_CLOSE(mapped(X), net(X), 0.0);
+
+    // the mapping is private, changed parameters do not reach the file
+    mapped.setParameters(Eigen::VectorXd::Zero(net.dimension()));
+    TEST_CHECK_CLOSE(mapped.currentParameters(), Eigen::VectorXd::Zero(net.dimension()), 0.0);
+    ClossNet reloaded;
+    reloaded.loadMapped(fileName);
+    checkLoaded(reloaded, net, 0.0);
+    std::remove(fileName);
+}
+}
+
+int main()
+{
+    std::srand(0);
+    testDimension();
+    testParameterRoundTrip();
+    testPredict();
+    testSaveText();
+    testSaveBinary();
+    return TEST_RESULT;
+}
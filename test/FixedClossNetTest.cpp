@@ -0,0 +1,108 @@
+#include <OpenANN/ActivationFunctions.h>
+#include <OpenANN/util/OpenANNException.h>
+#include <Eigen/Core>
+#include <cstdlib>
+
+#include "ClossNet.h"
+#include "FixedClossNet.h"
+#include "TestMacros.h"
+
+namespace
+{
+/**
+ * Set parameters that differ from the initialization, weights and biases
+ * must not be mixed up by FixedClossNet::load().
+ */
+void setRandomParameters(ClossNet& net)
+{
+    net.setParameters(Eigen::VectorXd::Random(net.dimension()));
+}
+
+template<typename Fixed>
+void checkPredictions(ClossNet& net, const Fixed& fixed)
+{
+    const Eigen::MatrixXd X = Eigen::MatrixXd::Random(50, Fixed::INPUTS);
+    Eigen::MatrixXd expected, Y;
+    net.reserveWorkspaces(1);
+    net.predict(0, X, expected);
+
+    fixed.predict(X, Y);
+    TEST_CHECK_CLOSE(Y, expected, 1e-12);
+    for(int n = 0; n < X.rows(); n++)
+    {
+        const typename Fixed::Input x = X.row(n).transpose();
+        TEST_CHECK_CLOSE(fixed(x), expected.row(n).transpose(), 1e-12);
+    }
+}
+
+void testDefaultTopology()
+{
+    ClossNet net;
+    net.inputLayer(2);
+    net.bpLayer(20, OpenANN::TANH);
+    net.bpLayer(20, OpenANN::TANH);
+    net.bpLayer(1, OpenANN::TANH);
+    setRandomParameters(net);
+
+    typedef FixedClossNet<2, 20, 20, 1> Fixed;
+    const Fixed fixed(net);
+    const int parameters = Fixed::PARAMETERS;
+    TEST_CHECK_EQUALS(parameters, (int) net.dimension());
+    TEST_CHECK_CLOSE(fixed.getParameters(), net.currentParameters(), 0.0);
+    checkPredictions(net, fixed);
+}
+
+void testActivationFunctions()
+{
+    ClossNet net;
+    net.inputLayer(3);
+    net.bpLayer(5, OpenANN::LOGISTIC);
+    net.bpLayer(4, OpenANN::TANH_SCALED);
+    net.bpLayer(4, OpenANN::RECTIFIER);
+    net.bpLayer(2, OpenANN::LINEAR);
+    setRandomParameters(net);
+
+    FixedClossNet<3, 5, 4, 4, 2> fixed;
+    fixed.load(net);
+    checkPredictions(net, fixed);
+}
+
+void testTopologyMismatch()
+{
+    ClossNet net;
+    net.inputLayer(2);
+    net.bpLayer(2, OpenANN::TANH);
+    net.bpLayer(1, OpenANN::TANH, 0.05, false);
+
+    bool thrown = false;
+    try
+    {
+        FixedClossNet<2, 2, 1> fixed(net);
+    }
+    catch(const OpenANN::OpenANNException&)
+    {
+        thrown = true;
+    }
+    TEST_CHECK(thrown);
+
+    thrown = false;
+    try
+    {
+        FixedClossNet<2, 3, 1> fixed(net);
+    }
+    catch(const OpenANN::OpenANNException&)
+    {
+        thrown = true;
+    }
+    TEST_CHECK(thrown);
+}
+}
+
+int main()
+{
+    std::srand(0);
+    testDefaultTopology();
+    testActivationFunctions();
+    testTopologyMismatch();
+    return TEST_RESULT;
+}
@@ -0,0 +1,180 @@
+#include <OpenANN/optimization/Optimizable.h>
+#include <OpenANN/optimization/StoppingCriteria.h>
+#include <Eigen/Core>
+#include <algorithm>
+#include <cstdlib>
+#include <vector>
+
+#include "MiniBatchOptimizer.h"
+#include "TestMacros.h"
+
+namespace
+{
+/**
+ * Every example has the error 0.5 (x_0^2 + 4 x_1^2), the optimizer starts
+ * at (1, 1). The order in which examples are visited is recorded.
+ */
+class Quadratic : public OpenANN::Optimizable
+{
+    Eigen::VectorXd x;
+    int N;
+public:
+    std::vector<int> visited;
+
+    Quadratic(int examples = 8) : x(Eigen::VectorXd::Ones(2)), N(examples) {}
+    virtual bool providesInitialization() { return true; }
+    virtual void initialize() {}
+    virtual unsigned int dimension() { return 2; }
+    virtual unsigned int examples() { return N; }
+    virtual const Eigen::VectorXd& currentParameters() { return x; }
+    virtual void setParameters(const Eigen::VectorXd& parameters) { x = parameters; }
+    virtual double error() { return 0.5 * (x(0) * x(0) + 4.0 * x(1) * x(1)); }
+    virtual bool providesGradient() { return true; }
+    virtual void errorGradient(std::vector<int>::const_iterator startN,
+                               std::vector<int>::const_iterator endN,
+                               double& value, Eigen::VectorXd& grad)
+    {
+        visited.insert(visited.end(), startN, endN);
+        value = error();
+        grad.resize(2);
+        grad << x(0), 4.0 * x(1);
+    }
+};
+
+Eigen::VectorXd vector2(double x0, double x1)
+{
+    Eigen::VectorXd v(2);
+    v << x0, x1;
+    return v;
+}
+
+/**
+ * One mini-batch of all examples, so each step() is one update.
+ */
+void checkSteps(MiniBatchOptimizer::Method method, const Eigen::VectorXd& first,
+                const Eigen::VectorXd& second, double tolerance)
+{
+    Quadratic quadratic;
+    MiniBatchOptimizer optimizer(method, 0.1, 8, 0.9);
+    optimizer.setOptimizable(quadratic);
+    TEST_CHECK(optimizer.step());
+    TEST_CHECK_CLOSE(quadratic.currentParameters(), first, tolerance);
+    TEST_CHECK(optimizer.step());
+    TEST_CHECK_CLOSE(quadratic.currentParameters(), second, tolerance);
+}
+
+void testMomentum()
+{
+    // g = (1, 4), v = -0.1 g, x = (0.9, 0.6)
+    // g = (0.9, 2.4), v = 0.9 (-0.1, -0.4) - 0.1 g = (-0.18, -0.6)
+    checkSteps(MiniBatchOptimizer::MOMENTUM, vector2(0.9, 0.6), vector2(0.72, 0.0), 1e-12);
+}
+
+void testNesterov()
+{
+    // x = (1, 1) - 1.9 * 0.1 (1, 4) = (0.81, 0.24), v = (-0.1, -0.4)
+    // g = (0.81, 0.96), x += 0.81 v - 0.19 g
+    checkSteps(MiniBatchOptimizer::NESTEROV, vector2(0.81, 0.24),
+               vector2(0.5751, -0.2664), 1e-12);
+}
+
+void testAdam()
+{
+    // the bias corrected first step moves each coordinate by the learning
+    // rate, the second one slightly less: m = (0.18, 0.72),
+    // s = (0.001809, 0.028944), rate = 0.1 sqrt(1 - 0.999^2) / (1 - 0.9^2)
+    checkSteps(MiniBatchOptimizer::ADAM, vector2(0.9, 0.9),
+               vector2(0.8004123, 0.8004122), 1e-6);
+}
+
+/**
+ * Every epoch visits all examples, the window w covers the examples
+ * [w * window, (w + 1) * window) and windows are visited in order.
+ */
+void checkEpoch(const std::vector<int>& visited, int examples, int window)
+{
+    TEST_CHECK_EQUALS((int) visited.size(), examples);
+    for(int start = 0; start < examples; start += window)
+    {
+        const int end = std::min(start + window, examples);
+        std::vector<int> part(visited.begin() + start, visited.begin() + end);
+        std::sort(part.begin(), part.end());
+        for(int i = start; i < end; i++)
+            TEST_CHECK_EQUALS(part[i - start], i);
+    }
+}
+
+void testShuffleWindow()
+{
+    const int examples = 10, window = 4;
+    Quadratic quadratic(examples);
+    MiniBatchOptimizer optimizer(MiniBatchOptimizer::MOMENTUM, 0.01, 3);
+    optimizer.setOptimizable(quadratic);
+    optimizer.setShuffleWindow(window);
+    bool shuffled = false;
+    for(int epoch = 0; epoch < 5; epoch++)
+    {
+        quadratic.visited.clear();
+        optimizer.step();
+        checkEpoch(quadratic.visited, examples, window);
+        for(int i = 0; i < examples; i++)
+            shuffled = shuffled || quadratic.visited[i] != i;
+    }
+    TEST_CHECK(shuffled);
+
+    // without a window, every epoch is one permutation of all examples
+    optimizer.setShuffleWindow(0);
+    quadratic.visited.clear();
+    optimizer.step();
+    checkEpoch(quadratic.visited, examples, examples);
+}
+
+void testStopCriteria()
+{
+    // momentum errors of the epochs: 2.5, 1.125, 0.2592
+    {
+        Quadratic quadratic;
+        MiniBatchOptimizer optimizer(MiniBatchOptimizer::MOMENTUM, 0.1, 8, 0.9);
+        OpenANN::StoppingCriteria stop;
+        stop.maximalIterations = 2;
+        optimizer.setStopCriteria(stop);
+        optimizer.setOptimizable(quadratic);
+        TEST_CHECK(optimizer.step());
+        TEST_CHECK_EQUALS(optimizer.currentError(), 2.5);
+        TEST_CHECK(!optimizer.step());
+        TEST_CHECK_CLOSE(optimizer.result(), vector2(0.72, 0.0), 1e-12);
+    }
+    {
+        Quadratic quadratic;
+        MiniBatchOptimizer optimizer(MiniBatchOptimizer::MOMENTUM, 0.1, 8, 0.9);
+        OpenANN::StoppingCriteria stop;
+        stop.minimalValue = 1.2;
+        optimizer.setStopCriteria(stop);
+        optimizer.setOptimizable(quadratic);
+        TEST_CHECK(optimizer.step());
+        TEST_CHECK(!optimizer.step());
+    }
+    {
+        Quadratic quadratic;
+        MiniBatchOptimizer optimizer(MiniBatchOptimizer::MOMENTUM, 0.1, 8, 0.9);
+        OpenANN::StoppingCriteria stop;
+        stop.minimalValueDifferences = 1.0;
+        optimizer.setStopCriteria(stop);
+        optimizer.setOptimizable(quadratic);
+        TEST_CHECK(optimizer.step());
+        TEST_CHECK(optimizer.step());
+        TEST_CHECK(!optimizer.step());
+    }
+}
+}
+
+int main()
+{
+    std::srand(0);
+    testMomentum();
+    testNesterov();
+    testAdam();
+    testShuffleWindow();
+    testStopCriteria();
+    return TEST_RESULT;
+}
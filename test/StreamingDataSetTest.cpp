@@ -0,0 +1,124 @@
+#include <Eigen/Core>
+#include <cstdio>
+#include <fstream>
+#include <memory>
+#include <string>
+
+#include "StreamingDataSet.h"
+#include "TestMacros.h"
+
+namespace
+{
+const int ROWS = 1000;
+const int CHUNK_ROWS = 64;
+const char* CSV_FILE = "StreamingDataSetTest.csv";
+const char* BINARY_FILE = "StreamingDataSetTest.bin";
+
+double inputValue(int row, int column)
+{
+    return row + 0.25 * column;
+}
+
+double outputValue(int row)
+{
+    return -0.5 * row;
+}
+
+/**
+ * Two inputs and one output per row, many times the rows of a chunk.
+ */
+void writeFiles()
+{
+    std::ofstream csv(CSV_FILE);
+    csv << "x1,x2,y\n";
+    for(int r = 0; r < ROWS; r++)
+        csv << inputValue(r, 0) << "," << inputValue(r, 1) << "," << outputValue(r) << "\n";
+    csv.close();
+
+    StreamingDataSet::CsvSource source(CSV_FILE, 2);
+    StreamingDataSet::BinarySource::write(source, 3, BINARY_FILE, CHUNK_ROWS);
+}
+
+void checkRow(StreamingDataSet& data, int i, int firstRow)
+{
+    const Eigen::VectorXd x = data.getInstance(i);
+    const Eigen::VectorXd y = data.getTarget(i);
+    TEST_CHECK_EQUALS(x(0), inputValue(firstRow + i, 0));
+    TEST_CHECK_EQUALS(x(1), inputValue(firstRow + i, 1));
+    TEST_CHECK_EQUALS(y(0), outputValue(firstRow + i));
+}
+
+void testSequential(const char* fileName)
+{
+    StreamingDataSet data(StreamingDataSet::open(fileName, 2), 2, 1, 0, -1, CHUNK_ROWS);
+    TEST_CHECK_EQUALS(data.samples(), ROWS);
+    // two epochs, the second one starts with the chunk prefetched last
+    for(int epoch = 0; epoch < 2; epoch++)
+        for(int i = 0; i < ROWS; i++)
+            checkRow(data, i, 0);
+}
+
+void testRandomAccess(const char* fileName)
+{
+    StreamingDataSet data(StreamingDataSet::open(fileName, 2), 2, 1, 0, -1, CHUNK_ROWS);
+    const int rows[] = {999, 0, 500, 63, 64, 65, 998, 1, 128};
+    for(int i = 0; i < (int) (sizeof(rows) / sizeof(rows[0])); i++)
+        checkRow(data, rows[i], 0);
+}
+
+void testRowRange(const char* fileName)
+{
+    const int startRow = 100, endRow = 900;
+    StreamingDataSet data(StreamingDataSet::open(fileName, 2), 2, 1, startRow, endRow,
+                          CHUNK_ROWS);
+    TEST_CHECK_EQUALS(data.samples(), endRow - startRow);
+    for(int i = 0; i < data.samples(); i++)
+        checkRow(data, i, startRow);
+
+    int rows = 0;
+    data.forEachChunk([&](const Eigen::MatrixXd& input, const Eigen::MatrixXd& output,
+                          int firstRow)
+    {
+        TEST_CHECK_EQUALS(firstRow, rows);
+        TEST_CHECK(input.rows() <= CHUNK_ROWS);
+        TEST_CHECK_EQUALS(input.rows(), output.rows());
+        for(int r = 0; r < input.rows(); r++)
+        {
+            TEST_CHECK_EQUALS(input(r, 0), inputValue(startRow + firstRow + r, 0));
+            TEST_CHECK_EQUALS(output(r, 0), outputValue(startRow + firstRow + r));
+        }
+        rows += input.rows();
+    });
+    TEST_CHECK_EQUALS(rows, endRow - startRow);
+}
+
+void testScaleInputs(const char* fileName)
+{
+    StreamingDataSet data(StreamingDataSet::open(fileName, 2), 2, 1, 0, -1, CHUNK_ROWS);
+    data.scaleInputs(-1.0, 1.0);
+    const double minData = inputValue(0, 0), maxData = inputValue(ROWS - 1, 1);
+    for(int i = 0; i < ROWS; i++)
+    {
+        Eigen::VectorXd expected(2);
+        for(int c = 0; c < 2; c++)
+            expected(c) = -1.0 + 2.0 * (inputValue(i, c) - minData) / (maxData - minData);
+        TEST_CHECK_CLOSE(data.getInstance(i), expected, 1e-12);
+    }
+}
+}
+
+int main()
+{
+    writeFiles();
+    const char* files[] = {CSV_FILE, BINARY_FILE};
+    for(int f = 0; f < 2; f++)
+    {
+        testSequential(files[f]);
+        testRandomAccess(files[f]);
+        testRowRange(files[f]);
+        testScaleInputs(files[f]);
+    }
+    std::remove(CSV_FILE);
+    std::remove(BINARY_FILE);
+    return TEST_RESULT;
+}
@@ -0,0 +1,196 @@
+#include <OpenANN/ActivationFunctions.h>
+#include <OpenANN/optimization/Optimizable.h>
+#include <OpenANN/optimization/StoppingCriteria.h>
+#include <Eigen/Core>
+#include <Eigen/LU>
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <vector>
+
+#include "BatchOptimizable.h"
+#include "ClossNet.h"
+#include "StreamingLMA.h"
+#include "TestMacros.h"
+
+namespace
+{
+typedef Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic, Eigen::RowMajor> RowMatrixXd;
+
+/**
+ * Residuals a exp(b t) + c - y of a curve fit. StreamingLMA evaluates them
+ * one example at a time unless the batched functions are enabled.
+ */
+class CurveFit : public OpenANN::Optimizable, public BatchOptimizable
+{
+    Eigen::VectorXd t, y, p;
+    bool batched;
+public:
+    CurveFit(bool batched)
+        : t(Eigen::VectorXd::LinSpaced(25, 0.0, 2.0)), p(3), batched(batched)
+    {
+        y = 2.0 * (0.8 * t.array()).exp() - 1.0 + 0.1 * (5.0 * t.array()).sin();
+        p << 1.0, 0.1, 0.0;
+    }
+    virtual bool providesInitialization() { return true; }
+    virtual void initialize() {}
+    virtual unsigned int dimension() { return 3; }
+    virtual unsigned int examples() { return t.size(); }
+    virtual const Eigen::VectorXd& currentParameters() { return p; }
+    virtual void setParameters(const Eigen::VectorXd& parameters) { p = parameters; }
+    virtual double error() { return residuals().squaredNorm(); }
+    virtual double error(unsigned n) { return residuals()(n); }
+    virtual bool providesGradient() { return true; }
+    virtual void errorGradient(int n, double& value, Eigen::VectorXd& grad)
+    {
+        const double e = std::exp(p(1) * t(n));
+        value = p(0) * e + p(2) - y(n);
+        grad.resize(3);
+        grad << e, p(0) * t(n) * e, 1.0;
+    }
+
+    virtual bool providesJacobian() { return batched; }
+    virtual void errors(Eigen::VectorXd& values) { values = residuals(); }
+    virtual void reserveWorkspaces(int count) {}
+    virtual void errorJacobian(int workspace, int startN, int endN,
+                               double* values, double* const* rows)
+    {
+        Eigen::VectorXd grad;
+        for(int n = startN; n < endN; n++)
+        {
+            errorGradient(n, values[n - startN], grad);
+            if(rows)
+                Eigen::Map<Eigen::VectorXd>(rows[n - startN], 3) = grad;
+        }
+    }
+
+    Eigen::VectorXd residuals()
+    {
+        return (p(0) * (p(1) * t.array()).exp() + p(2)).matrix() - y;
+    }
+};
+
+/**
+ * Levenberg-Marquardt iterations with the full Jacobian and a dense
+ * J^T J, same damping rules as StreamingLMA.
+ */
+class DenseLMA
+{
+    OpenANN::Optimizable& opt;
+    BatchOptimizable& batch;
+public:
+    Eigen::VectorXd parameters, residuals;
+    double mu, nu;
+
+    DenseLMA(OpenANN::Optimizable& opt, BatchOptimizable& batch)
+        : opt(opt), batch(batch), parameters(opt.currentParameters()), mu(-1.0), nu(2.0)
+    {
+    }
+
+    void step()
+    {
+        const int N = opt.examples(), n = opt.dimension();
+        opt.setParameters(parameters);
+        RowMatrixXd J(N, n);
+        std::vector<double*> rows(N);
+        for(int i = 0; i < N; i++)
+            rows[i] = J.data() + i * n;
+        residuals.resize(N);
+        batch.reserveWorkspaces(1);
+        batch.errorJacobian(0, 0, N, residuals.data(), rows.data());
+
+        const Eigen::MatrixXd JtJ = J.transpose() * J;
+        const Eigen::VectorXd Jtr = J.transpose() * residuals;
+        if(mu < 0.0)
+            mu = 1e-3 * JtJ.diagonal().maxCoeff();
+        while(true)
+        {
+            const Eigen::MatrixXd damped = JtJ + mu * Eigen::MatrixXd::Identity(n, n);
+            const Eigen::VectorXd delta = -damped.fullPivLu().solve(Jtr);
+            const Eigen::VectorXd candidate = parameters + delta;
+            opt.setParameters(candidate);
+            Eigen::VectorXd candidateResiduals;
+            batch.errors(candidateResiduals);
+            const double rho = (residuals.squaredNorm() - candidateResiduals.squaredNorm())
+                               / delta.dot(mu * delta - Jtr);
+            if(rho > 0.0)
+            {
+                parameters = candidate;
+                residuals = candidateResiduals;
+                mu *= std::max(1.0 / 3.0, 1.0 - std::pow(2.0 * rho - 1.0, 3));
+                nu = 2.0;
+                return;
+            }
+            mu *= nu;
+            nu *= 2.0;
+        }
+    }
+};
+
+/**
+ * Compare iterations of StreamingLMA on opt with DenseLMA on an identical
+ * copy.
+ */
+void checkSteps(OpenANN::Optimizable& opt, OpenANN::Optimizable& copy,
+                BatchOptimizable& batchCopy, int chunkSize, int threads)
+{
+    StreamingLMA lma;
+    OpenANN::StoppingCriteria stop;
+    stop.maximalIterations = 100;
+    lma.setStopCriteria(stop);
+    lma.setOptimizable(opt);
+    lma.setChunkSize(chunkSize);
+    lma.setThreads(threads);
+
+    DenseLMA reference(copy, batchCopy);
+    for(int i = 0; i < 5; i++)
+    {
+        TEST_CHECK(lma.step());
+        reference.step();
+        TEST_CHECK_EQUALS(lma.currentIteration(), i + 1);
+        TEST_CHECK_CLOSE(opt.currentParameters(), reference.parameters, 1e-9);
+        TEST_CHECK(std::abs(lma.currentError() - reference.residuals.mean()) < 1e-12);
+    }
+}
+
+void testCurveFit()
+{
+    // residuals one example at a time
+    CurveFit single(false), singleCopy(false);
+    checkSteps(single, singleCopy, singleCopy, 4, 1);
+
+    // tiles, several chunks and threads
+    CurveFit batched(true), batchedCopy(true);
+    checkSteps(batched, batchedCopy, batchedCopy, 4, 3);
+}
+
+void createNet(ClossNet& net, Eigen::MatrixXd& X, Eigen::MatrixXd& Y)
+{
+    net.inputLayer(2);
+    net.bpLayer(4, OpenANN::TANH);
+    net.bpLayer(1, OpenANN::TANH);
+    net.trainingSet(X, Y);
+}
+
+void testNet()
+{
+    Eigen::MatrixXd X = Eigen::MatrixXd::Random(30, 2);
+    Eigen::MatrixXd Y = (X.col(0).array() * X.col(1).array() > 0.0)
+                        .cast<double>().matrix() * 2.0 - Eigen::MatrixXd::Ones(30, 1);
+    ClossNet net, copy;
+    createNet(net, X, Y);
+    createNet(copy, X, Y);
+    const Eigen::VectorXd parameters = 0.5 * Eigen::VectorXd::Random(net.dimension());
+    net.setParameters(parameters);
+    copy.setParameters(parameters);
+    checkSteps(net, copy, copy, 7, 3);
+}
+}
+
+int main()
+{
+    std::srand(0);
+    testCurveFit();
+    testNet();
+    return TEST_RESULT;
+}
@@ -0,0 +1,55 @@
+#ifndef TESTMACROS_H_
+#define TESTMACROS_H_
+
+#include <iostream>
+
+/*
+ * Minimal checks for the test executables. A failed check prints its
+ * location and the test continues, main() returns TEST_RESULT so that
+ * ctest reports the executable as failed.
+ */
+
+namespace Test
+{
+inline int& failures()
+{
+    static int count = 0;
+    return count;
+}
+}
+
+#define TEST_CHECK(condition) \
+    do { \
+        if(!(condition)) \
+        { \
+            std::cerr << __FILE__ << ":" << __LINE__ << ": check failed: " \
+                      << #condition << std::endl; \
+            Test::failures()++; \
+        } \
+    } while(0)
+
+#define TEST_CHECK_EQUALS(actual, expected) \
+    do { \
+        if(!((actual) == (expected))) \
+        { \
+            std::cerr << __FILE__ << ":" << __LINE__ << ": " << #actual << " is " \
+                      << (actual) << ", expected " << (expected) << std::endl; \
+            Test::failures()++; \
+        } \
+    } while(0)
+
+// maximum absolute difference of two Eigen objects
+#define TEST_CHECK_CLOSE(actual, expected, tolerance) \
+    do { \
+        const double testDifference = ((actual) - (expected)).cwiseAbs().maxCoeff(); \
+        if(!(testDifference <= (tolerance))) \
+        { \
+            std::cerr << __FILE__ << ":" << __LINE__ << ": " << #actual << " differs from " \
+                      << #expected << " by " << testDifference << std::endl; \
+            Test::failures()++; \
+        } \
+    } while(0)
+
+#define TEST_RESULT (Test::failures() == 0 ? 0 : 1)
+
+#endif // TESTMACROS_H_